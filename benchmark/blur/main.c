@@ -0,0 +1,110 @@
+// Micro-benchmark of the glyph blur in fontstash, the SSE2/NEON passes against the scalar ones.
+//
+//   cc -O2 -I ../../libs/nanovg/src main.c -o blurbench -lm -lpthread
+//   ./blurbench [font.ttf] [blur]
+//
+// Glyphs of 12 to 200 px are rasterized with the padding fontstash gives blurred glyphs and blurred
+// both ways, times are microseconds per glyph. Build with -DFONS_NO_SIMD to check the scalar build.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FONTSTASH_IMPLEMENTATION
+#include "fontstash.h"
+
+static double now(void)
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void blurScalar(unsigned char* dst, int w, int h, int blur)
+{
+	int alpha = fons__blurAlpha(blur);
+	fons__blurRows(dst, w, h, w, alpha);
+	fons__blurCols(dst, w, h, w, alpha);
+	fons__blurRows(dst, w, h, w, alpha);
+	fons__blurCols(dst, w, h, w, alpha);
+}
+
+// Runs the blur over copies of the glyph for about 0.2 s.
+static double measure(const unsigned char* glyph, unsigned char* work, int w, int h, int blur, int simd)
+{
+	double t0 = now(), t;
+	int n = 0;
+	do {
+		memcpy(work, glyph, w*h);
+		if (simd) fons__blur(NULL, work, w, h, w, blur);
+		else blurScalar(work, w, h, blur);
+		n++;
+		t = now() - t0;
+	} while (t < 0.2);
+	return t * 1e6 / n;
+}
+
+int main(int argc, char* argv[])
+{
+	static const int sizes[] = { 12, 16, 24, 32, 48, 64, 96, 128, 160, 200 };
+	const char* path = argc > 1 ? argv[1] : "../../example/bin/data/Roboto-Regular.ttf";
+	int blur = argc > 2 ? atoi(argv[2]) : 6;
+	FONSparams params;
+	FONScontext* stash;
+	FONSfont* font;
+	int i, fontIndex, g;
+
+	if (blur < 1) blur = 1;
+	if (blur > 20) blur = 20;
+
+	memset(&params, 0, sizeof(params));
+	params.width = 512;
+	params.height = 512;
+	params.flags = FONS_ZERO_TOPLEFT;
+	stash = fonsCreateInternal(&params);
+	if (stash == NULL) return 1;
+	fontIndex = fonsAddFont(stash, "sans", path);
+	if (fontIndex == FONS_INVALID) {
+		fprintf(stderr, "could not load %s\n", path);
+		return 1;
+	}
+	font = stash->fonts[fontIndex];
+	g = fons__tt_getGlyphIndex(&font->font, 'g');
+
+#if defined(FONS_SSE2)
+	printf("simd sse2, blur %d\n", blur);
+#elif defined(FONS_NEON)
+	printf("simd neon, blur %d\n", blur);
+#else
+	printf("simd none, blur %d\n", blur);
+#endif
+	printf("%6s %9s %10s %10s %8s %s\n", "size", "glyph", "scalar_us", "simd_us", "speedup", "same");
+
+	for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+		float scale = fons__tt_getPixelHeightScale(&font->font, (float)sizes[i]);
+		int advance, lsb, x0, y0, x1, y1, w, h, pad = blur+2, same;
+		unsigned char *glyph, *a, *b;
+		double ts, tv;
+
+		fons__tt_buildGlyphBitmap(&font->font, g, (float)sizes[i], scale, &advance, &lsb, &x0, &y0, &x1, &y1);
+		w = x1-x0 + pad*2;
+		h = y1-y0 + pad*2;
+		glyph = (unsigned char*)calloc(w*h, 1);
+		a = (unsigned char*)malloc(w*h);
+		b = (unsigned char*)malloc(w*h);
+		if (glyph == NULL || a == NULL || b == NULL) return 1;
+		stash->scratch.n = 0;
+		fons__tt_renderGlyphBitmap(&font->font, glyph + pad + pad*w, w-pad*2, h-pad*2, w, scale, scale, g);
+
+		ts = measure(glyph, a, w, h, blur, 0);
+		tv = measure(glyph, b, w, h, blur, 1);
+		same = memcmp(a, b, w*h) == 0;
+		printf("%6d %4dx%-4d %10.2f %10.2f %7.2fx %s\n", sizes[i], w, h, ts, tv, ts / tv, same ? "yes" : "no");
+
+		free(glyph);
+		free(a);
+		free(b);
+	}
+
+	fonsDeleteInternal(stash);
+	return 0;
+}
@@ -0,0 +1,81 @@
+// Benchmark of glyph lookups in fontstash, the cost per glyph of text whose glyphs are already in
+// the atlas, drawn and measured.
+//
+//   cc -O2 -I ../../libs/nanovg/src main.c -o glyphbench -lm -lpthread
+//   ./glyphbench [font.ttf]
+//
+// The same line is drawn at 1 to 64 sizes, every size adds its own glyphs to the lookup tables.
+// Times are nanoseconds per glyph, the best of 5 runs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FONTSTASH_IMPLEMENTATION
+#include "fontstash.h"
+
+static const char* text = "AVAWAy To. The quick brown fox jumps over the lazy dog. Typography, kerning: We, Yo, LT, P.";
+
+static double now(void)
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// Draws or measures the text once at every size, returns nanoseconds per glyph.
+static double run(FONScontext* stash, int nsizes, int measure, int repeat)
+{
+	double best = 1e30;
+	int r, i, k, n = (int)strlen(text);
+	for (r = 0; r < 5; r++) {
+		double t = now();
+		for (i = 0; i < repeat; i++) {
+			for (k = 0; k < nsizes; k++) {
+				fonsSetSize(stash, 10.0f + k);
+				if (measure)
+					fonsTextBounds(stash, 0, 0, text, NULL, NULL);
+				else
+					fonsDrawText(stash, 0, 0, text, NULL);
+			}
+		}
+		t = (now() - t) * 1e9 / ((double)repeat * nsizes * n);
+		if (t < best) best = t;
+	}
+	return best;
+}
+
+int main(int argc, char* argv[])
+{
+	static const int sizes[] = { 1, 8, 32, 64 };
+	const char* path = argc > 1 ? argv[1] : "../../example/bin/data/Roboto-Regular.ttf";
+	FONSparams params;
+	FONScontext* stash;
+	int i, font;
+
+	memset(&params, 0, sizeof(params));
+	params.width = 4096;
+	params.height = 4096;
+	params.flags = FONS_ZERO_TOPLEFT;
+	stash = fonsCreateInternal(&params);
+	if (stash == NULL) return 1;
+
+	font = fonsAddFont(stash, "font", path);
+	if (font == FONS_INVALID) {
+		printf("Could not load %s\n", path);
+		fonsDeleteInternal(stash);
+		return 1;
+	}
+	fonsSetFont(stash, font);
+
+	printf("%6s %8s %8s %8s\n", "sizes", "glyphs", "draw_ns", "bounds_ns");
+	for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+		double draw, bounds;
+		run(stash, sizes[i], 0, 1);
+		draw = run(stash, sizes[i], 0, 20000 / sizes[i]);
+		bounds = run(stash, sizes[i], 1, 20000 / sizes[i]);
+		printf("%6d %8d %8.2f %8.2f\n", sizes[i], fonsGlyphMisses(stash), draw, bounds);
+	}
+
+	fonsDeleteInternal(stash);
+	return 0;
+}
@@ -0,0 +1,401 @@
+#include "ofMain.h"
+
+#include "ofxNanoVG.h"
+#include "nanovg_null.h"
+
+// Headless benchmark of ofxNanoVG::Canvas.
+//
+//   benchmark [--backend null|software] [--frames N] [--warmup N]
+//             [--size WxH] [--threads N] [--font path] [--out file.json]
+//             [--check-threads]
+//
+// Every scene is drawn for a few warm-up frames and then measured. The result
+// is written as JSON, times are milliseconds per frame and counters are
+// averaged per frame. Phase timings need nanovg.c built with NVG_PROFILE
+// (see config.make), otherwise they are reported as 0.
+//
+// --check-threads draws the first frames of every scene with the software
+// backend on one thread and on N threads and fails if the pixels differ.
+
+static const char* LOREM =
+	"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor "
+	"incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud "
+	"exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure "
+	"dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur. "
+	"Excepteur sint occaecat cupidatat non proident, sunt in culpa qui officia deserunt "
+	"mollit anim id est laborum.";
+
+struct Scene
+{
+	const char* name;
+	bool needs_font;
+	void (*draw)(ofxNanoVG::Canvas& c, int frame);
+};
+
+#pragma mark - Scenes
+
+static void roundedRects(ofxNanoVG::Canvas& c, int frame)
+{
+	const int N = 4000;
+
+	float w = c.getWidth();
+	float h = c.getHeight();
+
+	for (int i = 0; i < N; i++)
+	{
+		float x = fmodf(i * 37.0f + frame, w);
+		float y = fmodf(i * 11.0f, h);
+
+		c.beginPath();
+		c.roundedRect(x, y, 24 + i % 17, 16 + i % 13, 2 + i % 7);
+		c.fillColor(ofColor(i % 255, 128, 255 - i % 255));
+		c.fillPath();
+
+		if (i % 4 == 0)
+		{
+			c.lineWidth(1.5);
+			c.strokeColor(ofColor(255));
+			c.strokePath();
+		}
+	}
+}
+
+static void noisyPolylines(ofxNanoVG::Canvas& c, int frame)
+{
+	const int LINES = 32;
+	const int POINTS = 1024;
+
+	float t = frame / 60.0f;
+
+	c.lineCap(ofxNanoVG::LineCap::ROUND);
+	c.lineJoin(ofxNanoVG::LineCap::ROUND);
+	c.lineWidth(6);
+	c.strokeColor(ofColor(255, 200));
+
+	for (int j = 0; j < LINES; j++)
+	{
+		c.beginPath();
+		for (int i = 0; i < POINTS; i++)
+		{
+			float x = c.getWidth() * 0.5 + ofSignedNoise(j, 0, t + i * 0.005) * c.getWidth() * 0.5;
+			float y = c.getHeight() * 0.5 + ofSignedNoise(0, j, t + i * 0.005) * c.getHeight() * 0.5;
+
+			if (i == 0) c.moveTo(x, y);
+			else c.lineTo(x, y);
+		}
+		c.strokePath();
+	}
+}
+
+static void gradients(ofxNanoVG::Canvas& c, int frame)
+{
+	const int N = 300;
+
+	for (int i = 0; i < N; i++)
+	{
+		ofRectangle r(fmodf(i * 53.0f + frame, c.getWidth()), fmodf(i * 29.0f, c.getHeight()), 120, 80);
+		ofFloatColor a = ofFloatColor::fromHsb((i % 32) / 32.0, 0.8, 1);
+		ofFloatColor b(0, 0.5);
+
+		c.beginPath();
+		switch (i % 3)
+		{
+			case 0:
+				c.rect(r);
+				c.fillPath(ofxNanoVG::LinearGradient(r.getTopLeft(), a, r.getBottomRight(), b));
+				break;
+			case 1:
+				c.circle(r.getCenter(), 40);
+				c.fillPath(ofxNanoVG::RadialGradient(r.getCenter(), 5, a, 40, b));
+				break;
+			default:
+				c.roundedRect(r, 10);
+				c.fillPath(ofxNanoVG::BoxGradient(r, 10, 12, a, b));
+				break;
+		}
+	}
+}
+
+static void paragraphs(ofxNanoVG::Canvas& c, int frame)
+{
+	c.textFont("sans");
+	c.fillColor(ofColor(255));
+	c.textAlign(ofxNanoVG::TextAlign::LEFT | ofxNanoVG::TextAlign::TOP);
+
+	for (int i = 0; i < 12; i++)
+	{
+		c.textSize(12 + (i % 4) * 2);
+		c.text(LOREM, (i % 3) * 330, (i / 3) * 180, 180 + (frame + i * 20) % 120);
+	}
+}
+
+static void rotatingText(ofxNanoVG::Canvas& c, int frame)
+{
+	c.textFont("sans");
+	c.fillColor(ofColor(255));
+	c.textAlign(ofxNanoVG::TextAlign::CENTER | ofxNanoVG::TextAlign::MIDDLE);
+
+	for (int i = 0; i < 100; i++)
+	{
+		c.push();
+		c.translate(fmodf(i * 97.0f, c.getWidth()), fmodf(i * 61.0f, c.getHeight()));
+		c.rotate(frame * 3 + i * 10);
+		c.textSize(16 + i % 48);
+		c.text("ofxNanoVG " + ofToString(i), 0, 0);
+		c.pop();
+	}
+}
+
+static const Scene SCENES[] = {
+	{ "rounded_rects", false, roundedRects },
+	{ "noisy_polylines", false, noisyPolylines },
+	{ "gradients", false, gradients },
+	{ "text_paragraphs", true, paragraphs },
+	{ "rotating_text", true, rotatingText },
+};
+
+#pragma mark - Runner
+
+struct Result
+{
+	double frame_time;
+	NVGframeStats stats;
+	NVGnullStats null_stats;
+};
+
+static Result run(ofxNanoVG::Canvas& canvas, const Scene& scene, int warmup, int frames)
+{
+	Result result;
+	memset(&result, 0, sizeof(result));
+
+	for (int i = 0; i < warmup + frames; i++)
+	{
+		unsigned long long t = ofGetElapsedTimeMicros();
+
+		canvas.begin();
+		scene.draw(canvas, i);
+		canvas.end();
+
+		if (i < warmup) continue;
+
+		result.frame_time += (ofGetElapsedTimeMicros() - t) / 1000.0;
+
+		NVGframeStats s;
+		nvgFrameStats(canvas.getContext(), &s);
+		result.stats.drawCallCount += s.drawCallCount;
+		result.stats.fillTriCount += s.fillTriCount;
+		result.stats.strokeTriCount += s.strokeTriCount;
+		result.stats.textTriCount += s.textTriCount;
+		result.stats.allocCount += s.allocCount;
+		result.stats.glyphMisses += s.glyphMisses;
+		result.stats.atlasResets += s.atlasResets;
+		result.stats.glyphEvictions += s.glyphEvictions;
+		result.stats.kernLookups += s.kernLookups;
+		result.stats.kernHits += s.kernHits;
+		result.stats.appendTime += s.appendTime;
+		result.stats.flattenTime += s.flattenTime;
+		result.stats.expandTime += s.expandTime;
+		result.stats.submitTime += s.submitTime;
+		result.stats.glyphTime += s.glyphTime;
+
+		if (canvas.getBackend() == ofxNanoVG::Backend::NULL_RENDERER)
+		{
+			NVGnullStats n;
+			nvgnullFrameStats(canvas.getContext(), &n);
+			result.null_stats.fillVerts += n.fillVerts;
+			result.null_stats.strokeVerts += n.strokeVerts;
+			result.null_stats.triangleVerts += n.triangleVerts;
+			result.null_stats.textureUploadBytes += n.textureUploadBytes;
+		}
+	}
+
+	return result;
+}
+
+// Number of bytes which differ between the frames of the canvas and of a single
+// threaded reference canvas.
+static size_t compareThreads(ofxNanoVG::Canvas& canvas, ofxNanoVG::Canvas& reference, const Scene& scene, int frames)
+{
+	size_t diff = 0;
+
+	for (int i = 0; i < frames; i++)
+	{
+		canvas.begin();
+		scene.draw(canvas, i);
+		canvas.end();
+
+		reference.begin();
+		scene.draw(reference, i);
+		reference.end();
+
+		const ofPixels& pa = canvas.getPixels();
+		const ofPixels& pb = reference.getPixels();
+		const unsigned char* a = pa.getPixels();
+		const unsigned char* b = pb.getPixels();
+		size_t n = (size_t)pa.getWidth() * pa.getHeight() * pa.getNumChannels();
+		for (size_t k = 0; k < n; k++)
+			if (a[k] != b[k]) diff++;
+	}
+
+	return diff;
+}
+
+static void writeResult(ostream& out, const Scene& scene, const Result& r, int frames, bool has_null_stats)
+{
+	double n = frames;
+
+	out << "    {\"name\": \"" << scene.name << "\""
+		<< ", \"frame_ms\": " << r.frame_time / n
+		<< ", \"append_ms\": " << r.stats.appendTime / n
+		<< ", \"flatten_ms\": " << r.stats.flattenTime / n
+		<< ", \"expand_ms\": " << r.stats.expandTime / n
+		<< ", \"submit_ms\": " << r.stats.submitTime / n
+		<< ", \"glyph_ms\": " << r.stats.glyphTime / n
+		<< ", \"buffer_growths\": " << r.stats.allocCount / n
+		<< ", \"glyph_misses\": " << r.stats.glyphMisses / n
+		<< ", \"atlas_resets\": " << r.stats.atlasResets / n
+		<< ", \"glyph_evictions\": " << r.stats.glyphEvictions / n
+		<< ", \"kern_lookups\": " << r.stats.kernLookups / n
+		<< ", \"kern_hits\": " << r.stats.kernHits / n
+		<< ", \"draw_calls\": " << r.stats.drawCallCount / n
+		<< ", \"fill_tris\": " << r.stats.fillTriCount / n
+		<< ", \"stroke_tris\": " << r.stats.strokeTriCount / n
+		<< ", \"text_tris\": " << r.stats.textTriCount / n;
+
+	if (has_null_stats)
+	{
+		out << ", \"fill_verts\": " << r.null_stats.fillVerts / n
+			<< ", \"stroke_verts\": " << r.null_stats.strokeVerts / n
+			<< ", \"triangle_verts\": " << r.null_stats.triangleVerts / n
+			<< ", \"texture_upload_bytes\": " << r.null_stats.textureUploadBytes / n;
+	}
+
+	out << "}";
+}
+
+int main(int argc, char* argv[])
+{
+	string backend_name = "null";
+	int frames = 200;
+	int warmup = 10;
+	int width = 1280, height = 720;
+	int threads = 1;
+	bool check_threads = false;
+	string font = "../../../example/bin/data/Roboto-Regular.ttf";
+	string out_path;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		string value = i + 1 < argc ? argv[i + 1] : "";
+
+		if (arg == "--backend") backend_name = value;
+		else if (arg == "--frames") frames = ofToInt(value);
+		else if (arg == "--warmup") warmup = ofToInt(value);
+		else if (arg == "--threads") threads = ofToInt(value);
+		else if (arg == "--font") font = value;
+		else if (arg == "--out") out_path = value;
+		else if (arg == "--check-threads")
+		{
+			check_threads = true;
+			continue;
+		}
+		else if (arg == "--size")
+		{
+			vector<string> wh = ofSplitString(value, "x");
+			if (wh.size() == 2)
+			{
+				width = ofToInt(wh[0]);
+				height = ofToInt(wh[1]);
+			}
+		}
+		else
+		{
+			cerr << "unknown option: " << arg << endl;
+			return 1;
+		}
+		i++;
+	}
+
+	ofxNanoVG::Backend::Type backend;
+	if (backend_name == "null") backend = ofxNanoVG::Backend::NULL_RENDERER;
+	else if (backend_name == "software") backend = ofxNanoVG::Backend::SOFTWARE;
+	else
+	{
+		cerr << "backend should be null or software" << endl;
+		return 1;
+	}
+
+	if (frames < 1) frames = 1;
+
+	if (check_threads && backend != ofxNanoVG::Backend::SOFTWARE)
+	{
+		cerr << "--check-threads needs the software backend" << endl;
+		return 1;
+	}
+
+	ofxNanoVG::Canvas canvas;
+	canvas.setThreads(threads);
+	canvas.allocate(width, height, backend);
+
+	bool has_font = canvas.loadFont(font, "sans");
+	if (!has_font)
+		ofLogWarning("benchmark") << "text scenes are skipped";
+
+	if (check_threads)
+	{
+		ofxNanoVG::Canvas reference;
+		reference.setThreads(1);
+		reference.allocate(width, height, backend);
+		if (has_font) reference.loadFont(font, "sans");
+
+		bool identical = true;
+		for (size_t i = 0; i < sizeof(SCENES) / sizeof(SCENES[0]); i++)
+		{
+			const Scene& scene = SCENES[i];
+			if (scene.needs_font && !has_font) continue;
+
+			size_t diff = compareThreads(canvas, reference, scene, 4);
+			cout << scene.name << ": " << (diff == 0 ? "identical" : ofToString(diff) + " bytes differ") << endl;
+			if (diff != 0) identical = false;
+		}
+
+		return identical ? 0 : 1;
+	}
+
+	ostringstream json;
+	json << "{\n"
+		<< "  \"backend\": \"" << backend_name << "\",\n"
+		<< "  \"width\": " << width << ",\n"
+		<< "  \"height\": " << height << ",\n"
+		<< "  \"threads\": " << threads << ",\n"
+		<< "  \"frames\": " << frames << ",\n"
+		<< "  \"scenes\": [\n";
+
+	bool first = true;
+	for (size_t i = 0; i < sizeof(SCENES) / sizeof(SCENES[0]); i++)
+	{
+		const Scene& scene = SCENES[i];
+		if (scene.needs_font && !has_font) continue;
+
+		Result r = run(canvas, scene, warmup, frames);
+
+		if (!first) json << ",\n";
+		first = false;
+		writeResult(json, scene, r, frames, backend == ofxNanoVG::Backend::NULL_RENDERER);
+	}
+
+	json << "\n  ]\n}\n";
+
+	if (out_path.empty())
+	{
+		cout << json.str();
+	}
+	else
+	{
+		ofstream file(ofToDataPath(out_path).c_str());
+		file << json.str();
+	}
+
+	return 0;
+}
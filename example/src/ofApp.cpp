@@ -15,6 +15,9 @@ public:
 		canvas.allocate(1280, 720);
 
 		assert(canvas.loadFont("Roboto-Regular.ttf", "sans"));
+		
+		// the text below zooms every frame, keep its glyphs to a few sizes
+		canvas.setFontSizeStep(1.25);
 	}
 
 	void update()
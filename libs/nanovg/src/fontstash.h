@@ -21,6 +21,15 @@
 
 #define FONS_INVALID -1
 
+// Glyphs drawn with fonsSetSDF() are rasterized once at FONS_SDF_SIZE pixels as signed distance fields
+// reaching FONS_SDF_PAD pixels out of the outline, stored as 0.5 + distance / (2*FONS_SDF_PAD).
+#ifndef FONS_SDF_SIZE
+#define FONS_SDF_SIZE 48
+#endif
+#ifndef FONS_SDF_PAD
+#define FONS_SDF_PAD 6
+#endif
+
 enum FONSflags {
 	FONS_ZERO_TOPLEFT = 1,
 	FONS_ZERO_BOTTOMLEFT = 2,
@@ -72,12 +81,16 @@ struct FONStextIter {
 	float x, y, nextx, nexty, scale, spacing;
 	unsigned int codepoint;
 	short isize, iblur;
+	int sdf;
 	struct FONSfont* font;
 	int prevGlyphIndex;
 	const char* str;
 	const char* next;
 	const char* end;
 	unsigned int utf8state;
+	int pending;	// The glyph of the quad is still rasterized by a worker thread.
+	int page;		// Atlas page of the quad, see fonsAddPage().
+	int measure;	// Set by fonsMeasureIterInit(), the quads have no texture coordinates.
 };
 typedef struct FONStextIter FONStextIter;
 
@@ -94,6 +107,70 @@ void fonsGetAtlasSize(FONScontext* s, int* width, int* height);
 int fonsExpandAtlas(FONScontext* s, int width, int height);
 // Reseta the whole stash.
 int fonsResetAtlas(FONScontext* stash, int width, int height);
+// Returns the number of glyph lookups that missed the cache and had to be rasterized.
+int fonsGlyphMisses(FONScontext* s);
+// Returns the number of kerning lookups of glyph pairs, and in hits those found in the kerning cache.
+int fonsKernLookups(FONScontext* s, int* hits);
+// Returns the number of atlas pixels taken by glyphs (the area below the skyline) on all pages, and
+// the size of the last page.
+int fonsAtlasUsage(FONScontext* s, int* width, int* height);
+// Returns a number that changes whenever the atlas is reset, quads of an older generation may point
+// at other glyphs.
+int fonsAtlasGeneration(FONScontext* s);
+// Returns a number that grows whenever glyphs are dropped from a column or a page of the atlas.
+int fonsEvictionStamp(FONScontext* s);
+// Returns the eviction stamp of the last time glyphs between x0 and x1 of a page were dropped,
+// quads drawn from there at an older stamp may point at other glyphs. Reset atlases are not counted.
+int fonsPageStamp(FONScontext* s, int page, int x0, int x1);
+
+// Eviction
+// Once frames are counted, a full atlas makes room by dropping the glyphs of the atlas column
+// (1/FONS_ATLAS_COLUMNS of its width) used least recently, instead of failing with FONS_ATLAS_FULL.
+// Glyphs looked up in the current frame are kept, quads already drawn from them stay valid.
+// Pending glyphs of worker threads are waited for before evicting.
+void fonsBeginFrame(FONScontext* s);
+// Keeps the glyphs between x0 and x1 of a page in the atlas until the next frame, for quads drawn
+// without looking up their glyphs.
+void fonsPinAtlas(FONScontext* s, int page, int x0, int x1);
+// Returns the number of glyphs dropped to make room.
+int fonsGlyphEvictions(FONScontext* s);
+
+// Pages
+// A full atlas that can not evict continues on another page instead of being reset. Glyphs stay on
+// the page they were packed into and are drawn from it (see FONStextIter.page), new glyphs only go
+// to the last page. The other functions work on the last page.
+// Pending glyphs are waited for, and the texture of the last page should be up to date before.
+// Starts a new last page of the given size and returns its index, or -1.
+int fonsAddPage(FONScontext* s, int width, int height);
+// Drops the glyphs of the page used least recently, but not in this frame, and swaps it with the
+// last page, which is started again in its memory. Returns the index of the page, or -1 if there
+// is no such page. The textures of the two pages have to be swapped as well.
+int fonsReusePage(FONScontext* s);
+// Returns the number of pages, including the last one.
+int fonsPageCount(FONScontext* s);
+// Returns the pixels and the size of a page.
+const unsigned char* fonsGetPageData(FONScontext* s, int page, int* width, int* height);
+// Returns the number of pixels of a page taken by glyphs, and its size.
+int fonsPageUsage(FONScontext* s, int page, int* width, int* height);
+
+// Glyph cache
+// Serializes the pixels of the atlas pages, the skyline of the last one and the glyph tables of
+// the fonts into a block allocated with malloc. Fonts are keyed by a hash of their data. The block is in native byte order.
+unsigned char* fonsSaveCache(FONScontext* s, int* size);
+// Replaces the atlas and all its pages with a block from fonsSaveCache(). Glyphs of fonts that are not in the stash,
+// or whose data changed, are discarded. Returns the number of fonts restored, or 0 when the block
+// is invalid or no font matched, in which case the atlas is left untouched.
+int fonsLoadCache(FONScontext* s, const unsigned char* data, int size);
+
+// Background rasterization
+// Missing glyphs are rasterized by worker threads, the glyph lookup only reserves atlas space and the
+// glyph stays pending (see FONStextIter.pending) until fonsUpdatePending() copies it into the atlas.
+// 0 threads rasterizes on the calling thread again. Returns 0 if threads are not available
+// (FONS_USE_FREETYPE or FONS_NO_THREADS).
+int fonsSetThreads(FONScontext* s, int nthreads);
+// Copies the glyphs finished by the workers into the atlas, with 'wait' set after waiting for all of
+// them. Returns the number of glyphs copied.
+int fonsUpdatePending(FONScontext* s, int wait);
 
 // Add fonts
 int fonsAddFont(FONScontext* s, const char* name, const char* path);
@@ -110,6 +187,9 @@ void fonsSetSize(FONScontext* s, float size);
 void fonsSetColor(FONScontext* s, unsigned int color);
 void fonsSetSpacing(FONScontext* s, float spacing);
 void fonsSetBlur(FONScontext* s, float blur);
+// Draws glyphs from distance fields, one per glyph for all sizes and blurs. The atlas has to be
+// drawn with a distance field shader, the blur is up to it.
+void fonsSetSDF(FONScontext* s, int sdf);
 void fonsSetAlign(FONScontext* s, int align);
 void fonsSetFont(FONScontext* s, int font);
 
@@ -117,6 +197,8 @@ void fonsSetFont(FONScontext* s, int font);
 float fonsDrawText(FONScontext* s, float x, float y, const char* string, const char* end);
 
 // Measure text
+// Measuring reads the glyph metrics from the font tables and keeps them in a cache of their own,
+// glyphs are not rasterized and the atlas is left alone.
 float fonsTextBounds(FONScontext* s, float x, float y, const char* string, const char* end, float* bounds);
 void fonsLineBounds(FONScontext* s, float y, float* miny, float* maxy);
 void fonsVertMetrics(FONScontext* s, float* ascender, float* descender, float* lineh);
@@ -124,6 +206,8 @@ void fonsVertMetrics(FONScontext* s, float* ascender, float* descender, float* l
 // Text iterator
 int fonsTextIterInit(FONScontext* stash, FONStextIter* iter, float x, float y, const char* str, const char* end);
 int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, struct FONSquad* quad);
+// Same as fonsTextIterInit() for measuring, the quads have the same geometry without rasterizing the glyphs.
+int fonsMeasureIterInit(FONScontext* stash, FONStextIter* iter, float x, float y, const char* str, const char* end);
 
 // Pull texture changes
 const unsigned char* fonsGetTextureData(FONScontext* stash, int* width, int* height);
@@ -139,6 +223,25 @@ void fonsDrawDebug(FONScontext* s, float x, float y);
 
 #define FONS_NOTUSED(v)  (void)sizeof(v)
 
+// Probes around glyph rasterization, can be defined before including the implementation.
+#ifndef FONS_TRACE_BEGIN
+#define FONS_TRACE_BEGIN(name)
+#endif
+#ifndef FONS_TRACE_END
+#define FONS_TRACE_END(name)
+#endif
+
+// SSE2 or NEON is used for blurring and rasterizing glyphs, unless FONS_NO_SIMD is defined.
+#ifndef FONS_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FONS_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FONS_NEON 1
+#endif
+#endif
+
 #ifdef FONS_USE_FREETYPE
 
 #include <ft2build.h>
@@ -232,7 +335,8 @@ void fons__tt_renderGlyphBitmap(FONSttFontImpl *font, unsigned char *output, int
 int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
 {
 	FT_Vector ftKerning;
-	FT_Get_Kerning(font->font, glyph1, glyph2, FT_KERNING_DEFAULT, &ftKerning);
+	// In font units like the other metrics, the current size of the face depends on the last glyph loaded.
+	FT_Get_Kerning(font->font, glyph1, glyph2, FT_KERNING_UNSCALED, &ftKerning);
 	return ftKerning.x;
 }
 
@@ -241,10 +345,18 @@ int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
 #define STB_TRUETYPE_IMPLEMENTATION
 static void* fons__tmpalloc(size_t size, void* up);
 static void fons__tmpfree(void* ptr, void* up);
+static void* fons__scratch(FONScontext* stash);
 #define STBTT_malloc(x,u)    fons__tmpalloc(x,u)
 #define STBTT_free(x,u)      fons__tmpfree(x,u)
 #include "stb_truetype.h"
 
+// Rasterizes glyphs instead of stb_truetype when FONS_COVERAGE_RASTERIZER is defined. It is faster,
+// but its pixels differ slightly, overlapping contours come out darker.
+#ifdef FONS_COVERAGE_RASTERIZER
+static void fons__rasterGlyph(stbtt_fontinfo* info, unsigned char* output, int outWidth, int outHeight, int outStride,
+							  float scaleX, float scaleY, int glyph);
+#endif
+
 struct FONSttFontImpl {
 	stbtt_fontinfo font;
 };
@@ -261,7 +373,7 @@ int fons__tt_loadFont(FONScontext *context, FONSttFontImpl *font, unsigned char
 	int stbError;
 	FONS_NOTUSED(dataSize);
 
-	font->font.userdata = context;
+	font->font.userdata = fons__scratch(context);
 	stbError = stbtt_InitFont(&font->font, data, 0);
 	return stbError;
 }
@@ -293,7 +405,11 @@ int fons__tt_buildGlyphBitmap(FONSttFontImpl *font, int glyph, float size, float
 void fons__tt_renderGlyphBitmap(FONSttFontImpl *font, unsigned char *output, int outWidth, int outHeight, int outStride,
 								float scaleX, float scaleY, int glyph)
 {
+#ifdef FONS_COVERAGE_RASTERIZER
+	fons__rasterGlyph(&font->font, output, outWidth, outHeight, outStride, scaleX, scaleY, glyph);
+#else
 	stbtt_MakeGlyphBitmap(&font->font, output, outWidth, outHeight, outStride, scaleX, scaleY, glyph);
+#endif
 }
 
 int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
@@ -307,7 +423,10 @@ int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
 #	define FONS_SCRATCH_BUF_SIZE 16000
 #endif
 #ifndef FONS_HASH_LUT_SIZE
-#	define FONS_HASH_LUT_SIZE 256
+#	define FONS_HASH_LUT_SIZE 256	// Initial slots of the glyph tables, power of two.
+#endif
+#ifndef FONS_CMAP_SIZE
+#	define FONS_CMAP_SIZE 0x3000	// Code points with their glyph index kept per font.
 #endif
 #ifndef FONS_INIT_FONTS
 #	define FONS_INIT_FONTS 4
@@ -315,9 +434,18 @@ int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
 #ifndef FONS_INIT_GLYPHS
 #	define FONS_INIT_GLYPHS 256
 #endif
+#ifndef FONS_MAX_METRICS
+#	define FONS_MAX_METRICS 4096	// Per font, the metrics cache starts over when full.
+#endif
+#ifndef FONS_KERN_CACHE_SIZE
+#	define FONS_KERN_CACHE_SIZE 1024	// Per font, power of two.
+#endif
 #ifndef FONS_INIT_ATLAS_NODES
 #	define FONS_INIT_ATLAS_NODES 256
 #endif
+#ifndef FONS_ATLAS_COLUMNS
+#	define FONS_ATLAS_COLUMNS 8	// Up to 32.
+#endif
 #ifndef FONS_VERTEX_COUNT
 #	define FONS_VERTEX_COUNT 1024
 #endif
@@ -350,13 +478,41 @@ struct FONSglyph
 {
 	unsigned int codepoint;
 	int index;
-	int next;
 	short size, blur;
 	short x0,y0,x1,y1;
 	short xadv,xoff,yoff;
+	short pending;
+	short sdf;
+	short page;		// -1 for glyphs of the metrics cache, they are not in the atlas.
+	int lastUse;	// Frame of the last lookup.
 };
 typedef struct FONSglyph FONSglyph;
 
+// Kerning of a glyph pair in font units, the same for all sizes.
+struct FONSkern
+{
+	unsigned int pair;	// First glyph index in the high 16 bits, 0xffffffff when empty.
+	int adv;
+};
+typedef struct FONSkern FONSkern;
+
+// Open addressed, a glyph is found in the slot of its hash or the ones after it.
+struct FONSslot
+{
+	unsigned int codepoint;
+	unsigned int variant;	// Size, blur and sdf of the glyph.
+	int glyph;				// -1 when empty.
+};
+typedef struct FONSslot FONSslot;
+
+struct FONSlut
+{
+	FONSslot* slots;
+	int cslots;
+	int nslots;
+};
+typedef struct FONSlut FONSlut;
+
 struct FONSfont
 {
 	FONSttFontImpl font;
@@ -370,7 +526,13 @@ struct FONSfont
 	FONSglyph* glyphs;
 	int cglyphs;
 	int nglyphs;
-	int lut[FONS_HASH_LUT_SIZE];
+	FONSlut lut;
+	FONSglyph* metrics;
+	int cmetrics;
+	int nmetrics;
+	FONSlut mlut;
+	FONSkern kern[FONS_KERN_CACHE_SIZE];
+	unsigned short* cmap;	// Glyph indices of the first FONS_CMAP_SIZE code points, 0xffff when not looked up yet.
 };
 typedef struct FONSfont FONSfont;
 
@@ -382,6 +544,7 @@ struct FONSstate
 	unsigned int color;
 	float blur;
 	float spacing;
+	int sdf;
 };
 typedef struct FONSstate FONSstate;
 
@@ -393,12 +556,38 @@ typedef struct FONSatlasNode FONSatlasNode;
 struct FONSatlas
 {
 	int width, height;
+	int columnWidth;	// Rects that fit are kept inside columns, see fons__evictColumn().
+	int column;			// Filled before the others.
 	FONSatlasNode* nodes;
 	int nnodes;
 	int cnodes;
 };
 typedef struct FONSatlas FONSatlas;
 
+// A page that was full, glyphs are no longer packed into it.
+struct FONSpage
+{
+	unsigned char* data;
+	int width, height;
+	int used;		// Area below the skyline when the page was full.
+	int pinnedFrame;
+	int stamps[FONS_ATLAS_COLUMNS];	// Eviction stamp of every column, see fonsPageStamp().
+};
+typedef struct FONSpage FONSpage;
+
+// Scratch memory for stb_truetype, one for each thread rasterizing glyphs.
+struct FONSscratch
+{
+	unsigned char* data;
+	int n;
+	struct FONScontext* stash;	// Receives FONS_SCRATCH_FULL, NULL on worker threads.
+	float* coverage;			// Kept from glyph to glyph, see fons__rasterGlyph().
+	int ccoverage;
+};
+typedef struct FONSscratch FONSscratch;
+
+struct FONSworkers;
+
 struct FONScontext
 {
 	FONSparams params;
@@ -413,29 +602,47 @@ struct FONScontext
 	float tcoords[FONS_VERTEX_COUNT*2];
 	unsigned int colors[FONS_VERTEX_COUNT];
 	int nverts;
-	unsigned char* scratch;
-	int nscratch;
+	FONSscratch scratch;
 	FONSstate states[FONS_MAX_STATES];
 	int nstates;
 	void (*handleError)(void* uptr, int error, int val);
 	void* errorUptr;
+	int nmisses;
+	int nkernLookups;
+	int nkernHits;
+	struct FONSworkers* workers;
+	int generation;		// Incremented when the atlas is reset.
+	int stamp;			// Incremented when glyphs are dropped from a column or a page.
+	int stamps[FONS_ATLAS_COLUMNS];	// Of the columns of the last page.
+	int frame;
+	int pinnedFrame;
+	unsigned int pinnedColumns;
+	int nevictions;
+	FONSpage* pages;	// The last page, being packed, is not in here and has the index npages.
+	int npages;
+	int cpages;
 };
 
+static void* fons__scratch(FONScontext* stash)
+{
+	return &stash->scratch;
+}
+
 static void* fons__tmpalloc(size_t size, void* up)
 {
 	unsigned char* ptr;
-	FONScontext* stash = (FONScontext*)up;
+	FONSscratch* scratch = (FONSscratch*)up;
 
 	// 16-byte align the returned pointer
 	size = (size + 0xf) & ~0xf;
 
-	if (stash->nscratch+(int)size > FONS_SCRATCH_BUF_SIZE) {
-		if (stash->handleError)
-			stash->handleError(stash->errorUptr, FONS_SCRATCH_FULL, stash->nscratch+(int)size);
+	if (scratch->data == NULL || scratch->n+(int)size > FONS_SCRATCH_BUF_SIZE) {
+		if (scratch->stash != NULL && scratch->stash->handleError)
+			scratch->stash->handleError(scratch->stash->errorUptr, FONS_SCRATCH_FULL, scratch->n+(int)size);
 		return NULL;
 	}
-	ptr = stash->scratch + stash->nscratch;
-	stash->nscratch += (int)size;
+	ptr = scratch->data + scratch->n;
+	scratch->n += (int)size;
 	return ptr;
 }
 
@@ -446,6 +653,205 @@ static void fons__tmpfree(void* ptr, void* up)
 	// empty
 }
 
+#if !defined(FONS_USE_FREETYPE) && defined(FONS_COVERAGE_RASTERIZER)
+
+// Glyphs are rasterized by adding up the signed area each line of the outline covers in a pixel,
+// and the change of it for the pixels right of the line, into a buffer of floats. The running sum
+// of the buffer, row after row, gives the coverage (see font-rs). Unlike the scanlines of
+// stb_truetype it is exact, and needs no edge lists.
+
+static void fons__rasterLine(float* acc, int w, int h, float x0, float y0, float x1, float y1)
+{
+	float dir, dxdy, x, t;
+	int y, ystart, yend;
+
+	if (y0 == y1) return;
+	// Lines left or right of the bitmap still add to the pixels in its first or last column.
+	x0 = x0 < 0.0f ? 0.0f : (x0 > (float)w ? (float)w : x0);
+	x1 = x1 < 0.0f ? 0.0f : (x1 > (float)w ? (float)w : x1);
+	if (y0 < y1) {
+		dir = 1.0f;
+	} else {
+		dir = -1.0f;
+		t = x0; x0 = x1; x1 = t;
+		t = y0; y0 = y1; y1 = t;
+	}
+	dxdy = (x1 - x0) / (y1 - y0);
+	x = x0;
+	if (y0 < 0.0f) x -= y0 * dxdy;
+	// Coordinates are positive from here on, casts round them down.
+	ystart = y0 < 0.0f ? 0 : (int)y0;
+	yend = y1 > (float)h ? h : (int)y1 + ((float)(int)y1 < y1);
+
+	for (y = ystart; y < yend; y++) {
+		float* row = acc + y*w;
+		float dy = ((float)(y+1) < y1 ? (float)(y+1) : y1) - ((float)y > y0 ? (float)y : y0);
+		float xnext = x + dxdy * dy;
+		float d = dy * dir;
+		float xa = x < xnext ? x : xnext;
+		float xb = x < xnext ? xnext : x;
+		int xai = (int)xa;
+		int xbi = (int)xb + ((float)(int)xb < xb);
+		float xafloor = (float)xai;
+		float xbceil = (float)xbi;
+		if (xbi <= xai + 1) {
+			// Within one pixel.
+			float xmf = 0.5f * (x + xnext) - xafloor;
+			row[xai] += d - d * xmf;
+			row[xai+1] += d * xmf;
+		} else {
+			float s = 1.0f / (xb - xa);
+			float xaf = xa - xafloor;
+			float a0 = 0.5f * s * (1.0f - xaf) * (1.0f - xaf);
+			float xbf = xb - xbceil + 1.0f;
+			float am = 0.5f * s * xbf * xbf;
+			int xi;
+			row[xai] += d * a0;
+			if (xbi == xai + 2) {
+				row[xai+1] += d * (1.0f - a0 - am);
+			} else {
+				float a1 = s * (1.5f - xaf);
+				row[xai+1] += d * (a1 - a0);
+				for (xi = xai+2; xi < xbi-1; xi++)
+					row[xi] += d * s;
+				row[xbi-1] += d * (1.0f - (a1 + (float)(xbi - xai - 3) * s) - am);
+			}
+			row[xbi] += d * am;
+		}
+		x = xnext;
+	}
+}
+
+static void fons__rasterQuad(float* acc, int w, int h, float x0, float y0, float x1, float y1, float x2, float y2)
+{
+	float devx = x0 - 2.0f*x1 + x2;
+	float devy = y0 - 2.0f*y1 + y2;
+	float devsq = devx*devx + devy*devy;
+	float px = x0, py = y0;
+	int i, n;
+
+	if (devsq < 0.333f) {
+		fons__rasterLine(acc, w, h, x0, y0, x2, y2);
+		return;
+	}
+	// Segments for a deviation of about 1/3 px.
+	n = 1 + (int)sqrtf(sqrtf(3.0f * devsq));
+	for (i = 1; i <= n; i++) {
+		float t = (float)i / (float)n;
+		float mt = 1.0f - t;
+		float qx = mt*mt*x0 + 2.0f*mt*t*x1 + t*t*x2;
+		float qy = mt*mt*y0 + 2.0f*mt*t*y1 + t*t*y2;
+		fons__rasterLine(acc, w, h, px, py, qx, qy);
+		px = qx;
+		py = qy;
+	}
+}
+
+// Turns the buffer into coverage, 4 pixels at a time with SSE2 or NEON.
+static void fons__rasterAccumulate(const float* acc, int w, int h, unsigned char* output, int outStride)
+{
+	float sum = 0.0f, c;
+	int x, y;
+#if defined(FONS_SSE2)
+	const __m128 sign = _mm_set1_ps(-0.0f), one = _mm_set1_ps(1.0f), s255 = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+	__m128 vsum = _mm_setzero_ps();
+#elif defined(FONS_NEON)
+	const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f), half = vdupq_n_f32(0.5f);
+	float32x4_t vsum = zero;
+#endif
+
+	for (y = 0; y < h; y++) {
+		const float* row = acc + y*w;
+		unsigned char* dst = output + y*outStride;
+		x = 0;
+#if defined(FONS_SSE2)
+		for (; x+4 <= w; x += 4) {
+			__m128 v = _mm_loadu_ps(row + x);
+			__m128i p;
+			int px;
+			v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+			v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+			v = _mm_add_ps(v, vsum);
+			vsum = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+			v = _mm_min_ps(_mm_andnot_ps(sign, v), one);
+			p = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, s255), half));
+			p = _mm_packs_epi32(p, p);
+			px = _mm_cvtsi128_si32(_mm_packus_epi16(p, p));
+			memcpy(dst + x, &px, 4);
+		}
+		sum = _mm_cvtss_f32(vsum);
+#elif defined(FONS_NEON)
+		for (; x+4 <= w; x += 4) {
+			float32x4_t v = vld1q_f32(row + x);
+			uint16x4_t p;
+			uint32_t px;
+			v = vaddq_f32(v, vextq_f32(zero, v, 3));
+			v = vaddq_f32(v, vextq_f32(zero, v, 2));
+			v = vaddq_f32(v, vsum);
+			vsum = vdupq_n_f32(vgetq_lane_f32(v, 3));
+			v = vminq_f32(vabsq_f32(v), one);
+			p = vmovn_u32(vcvtq_u32_f32(vmlaq_n_f32(half, v, 255.0f)));
+			px = vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(p, p))), 0);
+			memcpy(dst + x, &px, 4);
+		}
+		sum = vgetq_lane_f32(vsum, 0);
+#endif
+		for (; x < w; x++) {
+			sum += row[x];
+			c = fabsf(sum);
+			if (c > 1.0f) c = 1.0f;
+			dst[x] = (unsigned char)(c * 255.0f + 0.5f);
+		}
+#if defined(FONS_SSE2)
+		vsum = _mm_set1_ps(sum);
+#elif defined(FONS_NEON)
+		vsum = vdupq_n_f32(sum);
+#endif
+	}
+}
+
+static void fons__rasterGlyph(stbtt_fontinfo* info, unsigned char* output, int outWidth, int outHeight, int outStride,
+							  float scaleX, float scaleY, int glyph)
+{
+	FONSscratch* scratch = (FONSscratch*)info->userdata;
+	stbtt_vertex* verts = NULL;
+	float px = 0.0f, py = 0.0f;
+	int i, n, ix0, iy0, size;
+
+	if (outWidth <= 0 || outHeight <= 0) return;
+
+	// Lines at the right edge reach two cells past the last pixel.
+	size = outWidth*outHeight + 2;
+	if (size > scratch->ccoverage) {
+		float* coverage = (float*)realloc(scratch->coverage, sizeof(float) * size);
+		if (coverage == NULL) return;
+		scratch->coverage = coverage;
+		scratch->ccoverage = size;
+	}
+	memset(scratch->coverage, 0, sizeof(float) * size);
+
+	// Same placement as stbtt_MakeGlyphBitmap(), y down.
+	stbtt_GetGlyphBitmapBox(info, glyph, scaleX, scaleY, &ix0, &iy0, NULL, NULL);
+	n = stbtt_GetGlyphShape(info, glyph, &verts);
+	for (i = 0; i < n; i++) {
+		const stbtt_vertex* v = &verts[i];
+		float x = v->x * scaleX - ix0;
+		float y = -v->y * scaleY - iy0;
+		if (v->type == STBTT_vline)
+			fons__rasterLine(scratch->coverage, outWidth, outHeight, px, py, x, y);
+		else if (v->type == STBTT_vcurve)
+			fons__rasterQuad(scratch->coverage, outWidth, outHeight, px, py,
+							 v->cx * scaleX - ix0, -v->cy * scaleY - iy0, x, y);
+		px = x;
+		py = y;
+	}
+	stbtt_FreeShape(info, verts);
+
+	fons__rasterAccumulate(scratch->coverage, outWidth, outHeight, output, outStride);
+}
+
+#endif
+
 // Copyright (c) 2008-2010 Bjoern Hoehrmann <bjoern@hoehrmann.de>
 // See http://bjoern.hoehrmann.de/utf-8/decoder/dfa/ for details.
 
@@ -494,6 +900,8 @@ static void fons__deleteAtlas(FONSatlas* atlas)
 	free(atlas);
 }
 
+static void fons__atlasReset(FONSatlas* atlas, int w, int h);
+
 static FONSatlas* fons__allocAtlas(int w, int h, int nnodes)
 {
 	FONSatlas* atlas = NULL;
@@ -513,11 +921,8 @@ static FONSatlas* fons__allocAtlas(int w, int h, int nnodes)
 	atlas->nnodes = 0;
 	atlas->cnodes = nnodes;
 
-	// Init root node.
-	atlas->nodes[0].x = 0;
-	atlas->nodes[0].y = 0;
-	atlas->nodes[0].width = (short)w;
-	atlas->nnodes++;
+	// Init root nodes.
+	fons__atlasReset(atlas, w, h);
 
 	return atlas;
 
@@ -555,6 +960,18 @@ static void fons__atlasRemoveNode(FONSatlas* atlas, int idx)
 	atlas->nnodes--;
 }
 
+// Inserts empty nodes from x0 to x1 at idx, starting a node at each column.
+static int fons__atlasInsertColumns(FONSatlas* atlas, int idx, int x0, int x1)
+{
+	while (x0 < x1) {
+		int x = fons__mini((x0 / atlas->columnWidth + 1) * atlas->columnWidth, x1);
+		if (fons__atlasInsertNode(atlas, idx++, x0, 0, x - x0) == 0)
+			return 0;
+		x0 = x;
+	}
+	return 1;
+}
+
 static void fons__atlasExpand(FONSatlas* atlas, int w, int h)
 {
 	// Insert node for empty space
@@ -568,13 +985,25 @@ static void fons__atlasReset(FONSatlas* atlas, int w, int h)
 {
 	atlas->width = w;
 	atlas->height = h;
+	atlas->columnWidth = fons__maxi(1, w / FONS_ATLAS_COLUMNS);
+	atlas->column = 0;
 	atlas->nnodes = 0;
 
-	// Init root node.
-	atlas->nodes[0].x = 0;
-	atlas->nodes[0].y = 0;
-	atlas->nodes[0].width = (short)w;
-	atlas->nnodes++;
+	// Init root nodes.
+	fons__atlasInsertColumns(atlas, 0, 0, w);
+}
+
+// Merges same height skyline segments that are next to each other, within a column.
+static void fons__atlasMergeNodes(FONSatlas* atlas)
+{
+	int i;
+	for (i = 0; i < atlas->nnodes-1; i++) {
+		if (atlas->nodes[i].y == atlas->nodes[i+1].y && atlas->nodes[i+1].x % atlas->columnWidth != 0) {
+			atlas->nodes[i].width += atlas->nodes[i+1].width;
+			fons__atlasRemoveNode(atlas, i+1);
+			i--;
+		}
+	}
 }
 
 static int fons__atlasAddSkylineLevel(FONSatlas* atlas, int idx, int x, int y, int w, int h)
@@ -602,15 +1031,34 @@ static int fons__atlasAddSkylineLevel(FONSatlas* atlas, int idx, int x, int y, i
 		}
 	}
 
-	// Merge same height skyline segments that are next to each other.
-	for (i = 0; i < atlas->nnodes-1; i++) {
-		if (atlas->nodes[i].y == atlas->nodes[i+1].y) {
-			atlas->nodes[i].width += atlas->nodes[i+1].width;
-			fons__atlasRemoveNode(atlas, i+1);
-			i--;
-		}
+	fons__atlasMergeNodes(atlas);
+
+	return 1;
+}
+
+// Lowers the skyline to the bottom between x0 and x1, the rects there must have been dropped.
+static int fons__atlasClear(FONSatlas* atlas, int x0, int x1)
+{
+	int i;
+
+	// Split the spans crossing the ends.
+	for (i = 0; i < atlas->nnodes; i++) {
+		int nx0 = atlas->nodes[i].x, nx1 = nx0 + atlas->nodes[i].width;
+		int cut = (nx0 < x0 && nx1 > x0) ? x0 : ((nx0 < x1 && nx1 > x1) ? x1 : -1);
+		if (cut == -1) continue;
+		atlas->nodes[i].width = (short)(cut - nx0);
+		if (fons__atlasInsertNode(atlas, i+1, cut, atlas->nodes[i].y, nx1 - cut) == 0)
+			return 0;
 	}
 
+	for (i = 0; i < atlas->nnodes && atlas->nodes[i].x < x0; i++);
+	while (i < atlas->nnodes && atlas->nodes[i].x < x1)
+		fons__atlasRemoveNode(atlas, i);
+	if (fons__atlasInsertColumns(atlas, i, x0, x1) == 0)
+		return 0;
+
+	fons__atlasMergeNodes(atlas);
+
 	return 1;
 }
 
@@ -624,6 +1072,8 @@ static int fons__atlasRectFits(FONSatlas* atlas, int i, int w, int h)
 	int spaceLeft;
 	if (x + w > atlas->width)
 		return -1;
+	if (w <= atlas->columnWidth && x / atlas->columnWidth != (x + w - 1) / atlas->columnWidth)
+		return -1;
 	spaceLeft = w;
 	while (spaceLeft > 0) {
 		if (i == atlas->nnodes) return -1;
@@ -635,27 +1085,42 @@ static int fons__atlasRectFits(FONSatlas* atlas, int i, int w, int h)
 	return y;
 }
 
-static int fons__atlasAddRect(FONSatlas* atlas, int rw, int rh, int* rx, int* ry)
+// Bottom left fit heuristic over the skyline spans starting between x0 and x1.
+static int fons__atlasFindRect(FONSatlas* atlas, int rw, int rh, int x0, int x1, int* rx, int* ry)
 {
-	int besth = atlas->height, bestw = atlas->width, besti = -1;
-	int bestx = -1, besty = -1, i;
+	int besth = atlas->height, bestw = atlas->width, besti = -1, i;
 
-	// Bottom left fit heuristic.
 	for (i = 0; i < atlas->nnodes; i++) {
-		int y = fons__atlasRectFits(atlas, i, rw, rh);
+		int y;
+		if (atlas->nodes[i].x < x0 || atlas->nodes[i].x >= x1) continue;
+		y = fons__atlasRectFits(atlas, i, rw, rh);
 		if (y != -1) {
 			if (y + rh < besth || (y + rh == besth && atlas->nodes[i].width < bestw)) {
 				besti = i;
 				bestw = atlas->nodes[i].width;
 				besth = y + rh;
-				bestx = atlas->nodes[i].x;
-				besty = y;
+				*rx = atlas->nodes[i].x;
+				*ry = y;
 			}
 		}
 	}
 
-	if (besti == -1)
-		return 0;
+	return besti;
+}
+
+static int fons__atlasAddRect(FONSatlas* atlas, int rw, int rh, int* rx, int* ry)
+{
+	int cx = atlas->column * atlas->columnWidth;
+	int bestx = -1, besty = -1, besti;
+
+	// Fill the current column first, so glyphs added around the same time are evicted together.
+	besti = fons__atlasFindRect(atlas, rw, rh, cx, cx + atlas->columnWidth, &bestx, &besty);
+	if (besti == -1) {
+		besti = fons__atlasFindRect(atlas, rw, rh, 0, atlas->width, &bestx, &besty);
+		if (besti == -1)
+			return 0;
+		atlas->column = bestx / atlas->columnWidth;
+	}
 
 	// Perform the actual packing.
 	if (fons__atlasAddSkylineLevel(atlas, besti, bestx, besty, rw, rh) == 0)
@@ -700,8 +1165,9 @@ FONScontext* fonsCreateInternal(FONSparams* params)
 	stash->params = *params;
 
 	// Allocate scratch buffer.
-	stash->scratch = (unsigned char*)malloc(FONS_SCRATCH_BUF_SIZE);
-	if (stash->scratch == NULL) goto error;
+	stash->scratch.data = (unsigned char*)malloc(FONS_SCRATCH_BUF_SIZE);
+	if (stash->scratch.data == NULL) goto error;
+	stash->scratch.stash = stash;
 
 	// Initialize implementation library
 	if (!fons__tt_init(stash)) goto error;
@@ -771,6 +1237,11 @@ void fonsSetBlur(FONScontext* stash, float blur)
 	fons__getState(stash)->blur = blur;
 }
 
+void fonsSetSDF(FONScontext* stash, int sdf)
+{
+	fons__getState(stash)->sdf = sdf;
+}
+
 void fonsSetAlign(FONScontext* stash, int align)
 {
 	fons__getState(stash)->align = align;
@@ -811,6 +1282,7 @@ void fonsClearState(FONScontext* stash)
 	state->font = 0;
 	state->blur = 0;
 	state->spacing = 0;
+	state->sdf = 0;
 	state->align = FONS_ALIGN_LEFT | FONS_ALIGN_BASELINE;
 }
 
@@ -818,6 +1290,10 @@ static void fons__freeFont(FONSfont* font)
 {
 	if (font == NULL) return;
 	if (font->glyphs) free(font->glyphs);
+	if (font->metrics) free(font->metrics);
+	if (font->lut.slots) free(font->lut.slots);
+	if (font->mlut.slots) free(font->mlut.slots);
+	if (font->cmap) free(font->cmap);
 	if (font->freeData && font->data) free(font->data);
 	free(font);
 }
@@ -840,6 +1316,10 @@ static int fons__allocFont(FONScontext* stash)
 	font->cglyphs = FONS_INIT_GLYPHS;
 	font->nglyphs = 0;
 
+	font->cmap = (unsigned short*)malloc(sizeof(unsigned short) * FONS_CMAP_SIZE);
+	if (font->cmap == NULL) goto error;
+	memset(font->cmap, 0xff, sizeof(unsigned short) * FONS_CMAP_SIZE);
+
 	stash->fonts[stash->nfonts++] = font;
 	return stash->nfonts-1;
 
@@ -889,9 +1369,8 @@ int fonsAddFontMem(FONScontext* stash, const char* name, unsigned char* data, in
 	strncpy(font->name, name, sizeof(font->name));
 	font->name[sizeof(font->name)-1] = '\0';
 
-	// Init hash lookup.
-	for (i = 0; i < FONS_HASH_LUT_SIZE; ++i)
-		font->lut[i] = -1;
+	for (i = 0; i < FONS_KERN_CACHE_SIZE; ++i)
+		font->kern[i].pair = 0xffffffff;
 
 	// Read in the font data.
 	font->dataSize = dataSize;
@@ -899,7 +1378,7 @@ int fonsAddFontMem(FONScontext* stash, const char* name, unsigned char* data, in
 	font->freeData = (unsigned char)freeData;
 
 	// Init font
-	stash->nscratch = 0;
+	stash->scratch.n = 0;
 	if (!fons__tt_loadFont(stash, &font->font, data, dataSize)) goto error;
 
 	// Store normalized line height. The real line height is got
@@ -929,6 +1408,85 @@ int fonsGetFontByName(FONScontext* s, const char* name)
 }
 
 
+static unsigned int fons__glyphVariant(short isize, short iblur, int sdf)
+{
+	return (unsigned short)isize | (unsigned int)iblur << 16 | (unsigned int)(sdf != 0) << 24;
+}
+
+static unsigned int fons__slotHash(unsigned int codepoint, unsigned int variant)
+{
+	return fons__hashint(codepoint ^ (variant << 21 | variant >> 11));
+}
+
+static int fons__lutFind(FONSlut* lut, unsigned int codepoint, unsigned int variant)
+{
+	unsigned int mask, h;
+	if (lut->slots == NULL) return -1;
+	mask = lut->cslots-1;
+	h = fons__slotHash(codepoint, variant) & mask;
+	for (;;) {
+		FONSslot* slot = &lut->slots[h];
+		if (slot->glyph == -1)
+			return -1;
+		if (slot->codepoint == codepoint && slot->variant == variant)
+			return slot->glyph;
+		h = (h+1) & mask;
+	}
+}
+
+static void fons__lutClear(FONSlut* lut)
+{
+	int i;
+	for (i = 0; i < lut->cslots; i++)
+		lut->slots[i].glyph = -1;
+	lut->nslots = 0;
+}
+
+static int fons__lutInsert(FONSlut* lut, unsigned int codepoint, unsigned int variant, int glyph)
+{
+	unsigned int mask, h;
+	FONSslot* slot;
+
+	// Keep at least half of the slots empty for short probes.
+	if ((lut->nslots+1)*2 > lut->cslots) {
+		FONSslot* old = lut->slots;
+		int i, cold = lut->cslots;
+		int cslots = lut->cslots == 0 ? FONS_HASH_LUT_SIZE : lut->cslots * 2;
+		FONSslot* slots = (FONSslot*)malloc(sizeof(FONSslot) * cslots);
+		if (slots == NULL) return 0;
+		lut->slots = slots;
+		lut->cslots = cslots;
+		fons__lutClear(lut);
+		for (i = 0; i < cold; i++) {
+			if (old[i].glyph != -1)
+				fons__lutInsert(lut, old[i].codepoint, old[i].variant, old[i].glyph);
+		}
+		free(old);
+	}
+
+	mask = lut->cslots-1;
+	h = fons__slotHash(codepoint, variant) & mask;
+	while (lut->slots[h].glyph != -1)
+		h = (h+1) & mask;
+	slot = &lut->slots[h];
+	slot->codepoint = codepoint;
+	slot->variant = variant;
+	slot->glyph = glyph;
+	lut->nslots++;
+	return 1;
+}
+
+static int fons__getGlyphIndex(FONSfont* font, unsigned int codepoint)
+{
+	int g;
+	if (codepoint < FONS_CMAP_SIZE && font->cmap[codepoint] != 0xffff)
+		return font->cmap[codepoint];
+	g = fons__tt_getGlyphIndex(&font->font, codepoint);
+	if (codepoint < FONS_CMAP_SIZE && g < 0xffff)
+		font->cmap[codepoint] = (unsigned short)g;
+	return g;
+}
+
 static FONSglyph* fons__allocGlyph(FONSfont* font)
 {
 	if (font->nglyphs+1 > font->cglyphs) {
@@ -987,68 +1545,849 @@ static void fons__blurRows(unsigned char* dst, int w, int h, int dstStride, int
 }
 
 
+// The passes are done 8 columns or rows at a time with SSE2 or NEON, unless FONS_NO_SIMD is defined.
+// Values stay within 16 bits (255 << ZPREC), so the results are the same as the code above.
+#if defined(FONS_SSE2) || defined(FONS_NEON)
+
+#ifdef FONS_SSE2
+typedef __m128i fons__v8;	// 8 x int16
+
+static fons__v8 fons__load8(const unsigned char* p)
+{
+	return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+}
+static void fons__store8(unsigned char* p, fons__v8 v)
+{
+	_mm_storel_epi64((__m128i*)p, _mm_packus_epi16(v, v));
+}
+#define fons__zero8()		_mm_setzero_si128()
+#define fons__set8(v)		_mm_set1_epi16((short)(v))
+#define fons__add8(a, b)	_mm_add_epi16(a, b)
+#define fons__sub8(a, b)	_mm_sub_epi16(a, b)
+#define fons__and8(a, b)	_mm_and_si128(a, b)
+#define fons__shl8(a, n)	_mm_slli_epi16(a, n)
+#define fons__shr8(a, n)	_mm_srai_epi16(a, n)
+#define fons__mulhi8(a, b)	_mm_mulhi_epi16(a, b)
+#define fons__sel8(m, a, b)	_mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+
+// Lanes from n on are set.
+static fons__v8 fons__mask8(int n)
+{
+	return _mm_cmpgt_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), _mm_set1_epi16((short)(n-1)));
+}
+
+static void fons__transpose8(fons__v8* v)
+{
+	__m128i a0 = _mm_unpacklo_epi16(v[0], v[1]), a1 = _mm_unpackhi_epi16(v[0], v[1]);
+	__m128i a2 = _mm_unpacklo_epi16(v[2], v[3]), a3 = _mm_unpackhi_epi16(v[2], v[3]);
+	__m128i a4 = _mm_unpacklo_epi16(v[4], v[5]), a5 = _mm_unpackhi_epi16(v[4], v[5]);
+	__m128i a6 = _mm_unpacklo_epi16(v[6], v[7]), a7 = _mm_unpackhi_epi16(v[6], v[7]);
+	__m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+	__m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+	__m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+	__m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+	v[0] = _mm_unpacklo_epi64(b0, b4); v[1] = _mm_unpackhi_epi64(b0, b4);
+	v[2] = _mm_unpacklo_epi64(b1, b5); v[3] = _mm_unpackhi_epi64(b1, b5);
+	v[4] = _mm_unpacklo_epi64(b2, b6); v[5] = _mm_unpackhi_epi64(b2, b6);
+	v[6] = _mm_unpacklo_epi64(b3, b7); v[7] = _mm_unpackhi_epi64(b3, b7);
+}
+#else
+typedef int16x8_t fons__v8;
+
+static fons__v8 fons__load8(const unsigned char* p)
+{
+	return vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p)));
+}
+static void fons__store8(unsigned char* p, fons__v8 v)
+{
+	vst1_u8(p, vqmovun_s16(v));
+}
+#define fons__zero8()		vdupq_n_s16(0)
+#define fons__set8(v)		vdupq_n_s16((short)(v))
+#define fons__add8(a, b)	vaddq_s16(a, b)
+#define fons__sub8(a, b)	vsubq_s16(a, b)
+#define fons__and8(a, b)	vandq_s16(a, b)
+#define fons__shl8(a, n)	vshlq_n_s16(a, n)
+#define fons__shr8(a, n)	vshrq_n_s16(a, n)
+#define fons__sel8(m, a, b)	vbslq_s16(vreinterpretq_u16_s16(m), a, b)
+
+// Lanes from n on are set.
+static fons__v8 fons__mask8(int n)
+{
+	static const short lanes[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	return vreinterpretq_s16_u16(vcgeq_s16(vld1q_s16(lanes), vdupq_n_s16((short)n)));
+}
+
+static fons__v8 fons__mulhi8(fons__v8 a, fons__v8 b)
+{
+	return vcombine_s16(vshrn_n_s32(vmull_s16(vget_low_s16(a), vget_low_s16(b)), 16),
+						vshrn_n_s32(vmull_s16(vget_high_s16(a), vget_high_s16(b)), 16));
+}
+
+static void fons__transpose8(fons__v8* v)
+{
+	int16x8x2_t a0 = vtrnq_s16(v[0], v[1]), a1 = vtrnq_s16(v[2], v[3]);
+	int16x8x2_t a2 = vtrnq_s16(v[4], v[5]), a3 = vtrnq_s16(v[6], v[7]);
+	int32x4x2_t b0 = vtrnq_s32(vreinterpretq_s32_s16(a0.val[0]), vreinterpretq_s32_s16(a1.val[0]));
+	int32x4x2_t b1 = vtrnq_s32(vreinterpretq_s32_s16(a0.val[1]), vreinterpretq_s32_s16(a1.val[1]));
+	int32x4x2_t b2 = vtrnq_s32(vreinterpretq_s32_s16(a2.val[0]), vreinterpretq_s32_s16(a3.val[0]));
+	int32x4x2_t b3 = vtrnq_s32(vreinterpretq_s32_s16(a2.val[1]), vreinterpretq_s32_s16(a3.val[1]));
+#define FONS_COMBINE(lo, hi, half) \
+	vcombine_s16(vget_##half##_s16(vreinterpretq_s16_s32(lo)), vget_##half##_s16(vreinterpretq_s16_s32(hi)))
+	v[0] = FONS_COMBINE(b0.val[0], b2.val[0], low); v[4] = FONS_COMBINE(b0.val[0], b2.val[0], high);
+	v[1] = FONS_COMBINE(b1.val[0], b3.val[0], low); v[5] = FONS_COMBINE(b1.val[0], b3.val[0], high);
+	v[2] = FONS_COMBINE(b0.val[1], b2.val[1], low); v[6] = FONS_COMBINE(b0.val[1], b2.val[1], high);
+	v[3] = FONS_COMBINE(b1.val[1], b3.val[1], low); v[7] = FONS_COMBINE(b1.val[1], b3.val[1], high);
+#undef FONS_COMBINE
+}
+#endif
+
+// The multiply keeps the high 16 bits of a signed product, alpha over 32767 wraps to alpha - 65536
+// and takes the missing diff back.
+struct FONSblurAlpha {
+	fons__v8 alpha;
+	fons__v8 wrap;
+};
+typedef struct FONSblurAlpha FONSblurAlpha;
+
+static fons__v8 fons__blurStep8(fons__v8* z, fons__v8 v, const FONSblurAlpha* a)
+{
+	fons__v8 d = fons__sub8(fons__shl8(v, ZPREC), *z);
+	*z = fons__add8(*z, fons__add8(fons__mulhi8(d, a->alpha), fons__and8(d, a->wrap)));
+	return fons__shr8(*z, ZPREC);
+}
+
+// The filters run on two blocks of 8 columns or rows at once, so that they do not wait for each
+// other. When the size is not a multiple of 8 the last block overlaps the one before, lanes out
+// of its mask keep their pixels. It is stored first, before the block it overlaps.
+
+static void fons__blurCols16(unsigned char* r0, unsigned char* r1, const fons__v8* m0, const fons__v8* m1,
+							 int w, int dstStride, const FONSblurAlpha* a)
+{
+	fons__v8 v0[8], v1[8], z0, z1;
+	int i, x, x0, end;
+	// Blocks of 8x8 pixels are transposed to run the filter on 8 rows at once.
+	z0 = z1 = fons__zero8(); // force zero border
+	for (x0 = 0, end = 1; end < w; x0 += 8) {
+		if (x0+8 > w) x0 = w-8;
+		for (i = 0; i < 8; i++) {
+			v0[i] = fons__load8(r0 + i*dstStride + x0);
+			v1[i] = fons__load8(r1 + i*dstStride + x0);
+		}
+		fons__transpose8(v0);
+		fons__transpose8(v1);
+		for (x = end-x0; x < 8; x++) {
+			v0[x] = fons__sel8(*m0, fons__blurStep8(&z0, v0[x], a), v0[x]);
+			v1[x] = fons__sel8(*m1, fons__blurStep8(&z1, v1[x], a), v1[x]);
+		}
+		fons__transpose8(v0);
+		fons__transpose8(v1);
+		for (i = 0; i < 8; i++) fons__store8(r1 + i*dstStride + x0, v1[i]);
+		for (i = 0; i < 8; i++) fons__store8(r0 + i*dstStride + x0, v0[i]);
+		end = x0+8;
+	}
+	for (i = 0; i < 8; i++) {
+		r0[i*dstStride + w-1] = 0; // force zero border
+		r1[i*dstStride + w-1] = 0;
+	}
+	z0 = z1 = fons__zero8();
+	for (x0 = w-8, end = w-2; end >= 0; x0 -= 8) {
+		if (x0 < 0) x0 = 0;
+		for (i = 0; i < 8; i++) {
+			v0[i] = fons__load8(r0 + i*dstStride + x0);
+			v1[i] = fons__load8(r1 + i*dstStride + x0);
+		}
+		fons__transpose8(v0);
+		fons__transpose8(v1);
+		for (x = end-x0; x >= 0; x--) {
+			v0[x] = fons__sel8(*m0, fons__blurStep8(&z0, v0[x], a), v0[x]);
+			v1[x] = fons__sel8(*m1, fons__blurStep8(&z1, v1[x], a), v1[x]);
+		}
+		fons__transpose8(v0);
+		fons__transpose8(v1);
+		for (i = 0; i < 8; i++) fons__store8(r1 + i*dstStride + x0, v1[i]);
+		for (i = 0; i < 8; i++) fons__store8(r0 + i*dstStride + x0, v0[i]);
+		end = x0-1;
+	}
+	for (i = 0; i < 8; i++) {
+		r0[i*dstStride] = 0; // force zero border
+		r1[i*dstStride] = 0;
+	}
+}
+
+static void fons__blurRows16(unsigned char* c0, unsigned char* c1, const fons__v8* m0, const fons__v8* m1,
+							 int h, int dstStride, const FONSblurAlpha* a)
+{
+	fons__v8 v0, v1, z0, z1;
+	int y;
+	z0 = z1 = fons__zero8(); // force zero border
+	for (y = dstStride; y < h*dstStride; y += dstStride) {
+		v0 = fons__load8(c0 + y);
+		v1 = fons__load8(c1 + y);
+		fons__store8(c1 + y, fons__sel8(*m1, fons__blurStep8(&z1, v1, a), v1));
+		fons__store8(c0 + y, fons__sel8(*m0, fons__blurStep8(&z0, v0, a), v0));
+	}
+	fons__store8(c1 + (h-1)*dstStride, fons__zero8()); // force zero border
+	fons__store8(c0 + (h-1)*dstStride, fons__zero8());
+	z0 = z1 = fons__zero8();
+	for (y = (h-2)*dstStride; y >= 0; y -= dstStride) {
+		v0 = fons__load8(c0 + y);
+		v1 = fons__load8(c1 + y);
+		fons__store8(c1 + y, fons__sel8(*m1, fons__blurStep8(&z1, v1, a), v1));
+		fons__store8(c0 + y, fons__sel8(*m0, fons__blurStep8(&z0, v0, a), v0));
+	}
+	fons__store8(c1, fons__zero8()); // force zero border
+	fons__store8(c0, fons__zero8());
+}
+
+static void fons__blurCols8(unsigned char* dst, int w, int h, int dstStride, const FONSblurAlpha* a, int alpha)
+{
+	fons__v8 m0, m1;
+	int y, y0, y1;
+	if (w < 8 || h < 8) {
+		fons__blurCols(dst, w, h, dstStride, alpha);
+		return;
+	}
+	// A last block alone goes with itself.
+	for (y = 0; y < h; y += 16) {
+		y0 = fons__mini(y, h-8);
+		y1 = y+8 < h ? fons__mini(y+8, h-8) : y0;
+		m0 = fons__mask8(y-y0);
+		m1 = fons__mask8(y+8 < h ? y+8-y1 : y-y0);
+		fons__blurCols16(dst + y0*dstStride, dst + y1*dstStride, &m0, &m1, w, dstStride, a);
+	}
+}
+
+static void fons__blurRows8(unsigned char* dst, int w, int h, int dstStride, const FONSblurAlpha* a, int alpha)
+{
+	fons__v8 m0, m1;
+	int x, x0, x1;
+	if (w < 8) {
+		fons__blurRows(dst, w, h, dstStride, alpha);
+		return;
+	}
+	for (x = 0; x < w; x += 16) {
+		x0 = fons__mini(x, w-8);
+		x1 = x+8 < w ? fons__mini(x+8, w-8) : x0;
+		m0 = fons__mask8(x-x0);
+		m1 = fons__mask8(x+8 < w ? x+8-x1 : x-x0);
+		fons__blurRows16(dst + x0, dst + x1, &m0, &m1, h, dstStride, a);
+	}
+}
+
+#endif
+
+static int fons__blurAlpha(int blur)
+{
+	// Calculate the alpha such that 90% of the kernel is within the radius. (Kernel extends to infinity)
+	float sigma = (float)blur * 0.57735f; // 1 / sqrt(3)
+	return (int)((1<<APREC) * (1.0f - expf(-2.3f / (sigma+1.0f))));
+}
+
 static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int dstStride, int blur)
 {
 	int alpha;
-	float sigma;
+#if defined(FONS_SSE2) || defined(FONS_NEON)
+	FONSblurAlpha a;
+#endif
 	(void)stash;
 
 	if (blur < 1)
 		return;
-	// Calculate the alpha such that 90% of the kernel is within the radius. (Kernel extends to infinity)
-	sigma = (float)blur * 0.57735f; // 1 / sqrt(3)
-	alpha = (int)((1<<APREC) * (1.0f - expf(-2.3f / (sigma+1.0f))));
+	alpha = fons__blurAlpha(blur);
+#if defined(FONS_SSE2) || defined(FONS_NEON)
+	a.alpha = fons__set8(alpha);
+	a.wrap = fons__set8(alpha > 32767 ? -1 : 0);
+	fons__blurRows8(dst, w, h, dstStride, &a, alpha);
+	fons__blurCols8(dst, w, h, dstStride, &a, alpha);
+	fons__blurRows8(dst, w, h, dstStride, &a, alpha);
+	fons__blurCols8(dst, w, h, dstStride, &a, alpha);
+#else
 	fons__blurRows(dst, w, h, dstStride, alpha);
 	fons__blurCols(dst, w, h, dstStride, alpha);
 	fons__blurRows(dst, w, h, dstStride, alpha);
 	fons__blurCols(dst, w, h, dstStride, alpha);
+#endif
 //	fons__blurrows(dst, w, h, dstStride, alpha);
 //	fons__blurcols(dst, w, h, dstStride, alpha);
 }
 
-static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
-								 short isize, short iblur)
-{
-	int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, x, y;
-	float scale;
-	FONSglyph* glyph = NULL;
-	unsigned int h;
-	float size = isize/10.0f;
-	int pad, added;
-	unsigned char* bdst;
-	unsigned char* dst;
+// Distance fields are computed from the glyph rendered at FONS_SDF_OVERSAMPLE (even) times its size.
+#ifndef FONS_SDF_OVERSAMPLE
+#	define FONS_SDF_OVERSAMPLE 4
+#endif
+#define FONS_SDF_FAR 2000
 
-	if (isize < 2) return NULL;
-	if (iblur > 20) iblur = 20;
-	pad = iblur+2;
+static void fons__edtCompare(short* off, int w, int x, int y, int ox, int oy)
+{
+	short* p = &off[(x + y*w)*2];
+	const short* q = &off[(x+ox + (y+oy)*w)*2];
+	int dx = q[0] + ox, dy = q[1] + oy;
+	if (dx*dx + dy*dy < p[0]*p[0] + p[1]*p[1]) {
+		p[0] = (short)dx;
+		p[1] = (short)dy;
+	}
+}
 
-	// Reset allocator.
-	stash->nscratch = 0;
+// Propagates the offset to the nearest seed pixel (offset 0) over the image, 8SSEDT.
+static void fons__edt(short* off, int w, int h)
+{
+	int x, y;
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			if (x > 0) fons__edtCompare(off, w, x, y, -1, 0);
+			if (y > 0) {
+				fons__edtCompare(off, w, x, y, 0, -1);
+				if (x > 0) fons__edtCompare(off, w, x, y, -1, -1);
+				if (x < w-1) fons__edtCompare(off, w, x, y, 1, -1);
+			}
+		}
+		for (x = w-2; x >= 0; x--)
+			fons__edtCompare(off, w, x, y, 1, 0);
+	}
+	for (y = h-1; y >= 0; y--) {
+		for (x = w-1; x >= 0; x--) {
+			if (x < w-1) fons__edtCompare(off, w, x, y, 1, 0);
+			if (y < h-1) {
+				fons__edtCompare(off, w, x, y, 0, 1);
+				if (x > 0) fons__edtCompare(off, w, x, y, -1, 1);
+				if (x < w-1) fons__edtCompare(off, w, x, y, 1, 1);
+			}
+		}
+		for (x = 1; x < w; x++)
+			fons__edtCompare(off, w, x, y, -1, 0);
+	}
+}
 
-	// Find code point and size.
-	h = fons__hashint(codepoint) & (FONS_HASH_LUT_SIZE-1);
-	i = font->lut[h];
-	while (i != -1) {
-		if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur)
-			return &font->glyphs[i];
-		i = font->glyphs[i].next;
+// Fills the gw*gh glyph box (padding included, its top left at xoff,yoff from the pen) with the
+// signed distance to the outline, positive inside, in the encoding of FONS_SDF_PAD.
+static void fons__distanceField(FONSttFontImpl* font, int g, float size, float scale, int xoff, int yoff,
+								unsigned char* dst, int gw, int gh, int dstStride)
+{
+	int os = FONS_SDF_OVERSAMPLE;
+	int w = gw*os, h = gh*os;
+	int advance, lsb, x0, y0, x1, y1, ox, oy, x, y, i, j;
+	unsigned char* img;
+	short* in;		// Offsets to the nearest pixel inside the outline.
+	short* out;		// And outside.
+
+	for (y = 0; y < gh; y++)
+		memset(&dst[y*dstStride], 0, gw);
+
+	img = (unsigned char*)calloc(w*h, 1);
+	in = (short*)malloc(sizeof(short)*2*w*h);
+	out = (short*)malloc(sizeof(short)*2*w*h);
+	if (img == NULL || in == NULL || out == NULL) goto done;
+
+	fons__tt_buildGlyphBitmap(font, g, size*os, scale*os, &advance, &lsb, &x0, &y0, &x1, &y1);
+	ox = x0 - xoff*os;
+	oy = y0 - yoff*os;
+	// stb_truetype boxes always fit the scaled up box, a hinted FreeType one may not.
+	if (ox < 0 || oy < 0 || ox + x1-x0 > w || oy + y1-y0 > h) goto done;
+	fons__tt_renderGlyphBitmap(font, &img[ox + oy*w], x1-x0, y1-y0, w, scale*os, scale*os, g);
+
+	for (i = 0; i < w*h; i++) {
+		int inside = img[i] >= 128;
+		in[i*2] = in[i*2+1] = inside ? 0 : FONS_SDF_FAR;
+		out[i*2] = out[i*2+1] = inside ? FONS_SDF_FAR : 0;
+	}
+	fons__edt(in, w, h);
+	fons__edt(out, w, h);
+
+	// Average the 2x2 samples around the center of each glyph pixel.
+	for (y = 0; y < gh; y++) {
+		for (x = 0; x < gw; x++) {
+			float d = 0.0f;
+			for (j = os/2-1; j <= os/2; j++) {
+				for (i = os/2-1; i <= os/2; i++) {
+					int k = (x*os+i) + (y*os+j)*w;
+					if (img[k] >= 128)
+						d += sqrtf((float)(out[k*2]*out[k*2] + out[k*2+1]*out[k*2+1])) - 0.5f;
+					else
+						d -= sqrtf((float)(in[k*2]*in[k*2] + in[k*2+1]*in[k*2+1])) - 0.5f;
+				}
+			}
+			d = 0.5f + d / (4.0f*os) / (2.0f*FONS_SDF_PAD);
+			dst[x + y*dstStride] = (unsigned char)(d <= 0.0f ? 0 : d >= 1.0f ? 255 : (int)(d*255.0f + 0.5f));
+		}
+	}
+
+done:
+	free(img);
+	free(in);
+	free(out);
+}
+
+// Background rasterization. stb_truetype only reads the font data, so workers can rasterize
+// from it with their own scratch memory. The atlas itself is only touched by the owning thread.
+#if !defined(FONS_USE_FREETYPE) && !defined(FONS_NO_THREADS)
+#define FONS_THREADS 1
+
+#ifdef _WIN32
+#include <windows.h>
+typedef CRITICAL_SECTION FONSmutex;
+typedef CONDITION_VARIABLE FONScond;
+typedef HANDLE FONSthread;
+static void fons__mutexInit(FONSmutex* m) { InitializeCriticalSection(m); }
+static void fons__mutexDestroy(FONSmutex* m) { DeleteCriticalSection(m); }
+static void fons__lock(FONSmutex* m) { EnterCriticalSection(m); }
+static void fons__unlock(FONSmutex* m) { LeaveCriticalSection(m); }
+static void fons__condInit(FONScond* c) { InitializeConditionVariable(c); }
+static void fons__condDestroy(FONScond* c) { FONS_NOTUSED(c); }
+static void fons__condWait(FONScond* c, FONSmutex* m) { SleepConditionVariableCS(c, m, INFINITE); }
+static void fons__condBroadcast(FONScond* c) { WakeAllConditionVariable(c); }
+#else
+#include <pthread.h>
+typedef pthread_mutex_t FONSmutex;
+typedef pthread_cond_t FONScond;
+typedef pthread_t FONSthread;
+static void fons__mutexInit(FONSmutex* m) { pthread_mutex_init(m, NULL); }
+static void fons__mutexDestroy(FONSmutex* m) { pthread_mutex_destroy(m); }
+static void fons__lock(FONSmutex* m) { pthread_mutex_lock(m); }
+static void fons__unlock(FONSmutex* m) { pthread_mutex_unlock(m); }
+static void fons__condInit(FONScond* c) { pthread_cond_init(c, NULL); }
+static void fons__condDestroy(FONScond* c) { pthread_cond_destroy(c); }
+static void fons__condWait(FONScond* c, FONSmutex* m) { pthread_cond_wait(c, m); }
+static void fons__condBroadcast(FONScond* c) { pthread_cond_broadcast(c); }
+#endif
+
+struct FONSjob
+{
+	FONSttFontImpl font;	// Copy, the user data is set to the scratch memory of the worker.
+	int fontIdx, glyphIdx;
+	int generation;
+	int glyph;
+	int width, height;		// Including the padding.
+	int pad, blur;
+	int sdf, xoff, yoff;
+	float size, scale;
+	unsigned char* bitmap;
+	struct FONSjob* next;
+};
+typedef struct FONSjob FONSjob;
+
+struct FONSworkers
+{
+	FONSthread* threads;
+	int nthreads;
+	FONSmutex lock;
+	FONScond start;
+	FONScond done;
+	FONSjob* queue;
+	FONSjob* queueTail;
+	FONSjob* finished;
+	int pending;			// Queued or being rasterized.
+	int quit;
+};
+typedef struct FONSworkers FONSworkers;
+
+static void fons__rasterizeJob(FONSjob* job, FONSscratch* scratch)
+{
+	int pad = job->pad;
+
+	// The zeroed padding gives the empty border fons__getGlyph() makes.
+	job->bitmap = (unsigned char*)calloc(job->width * job->height, 1);
+	if (job->bitmap == NULL) return;
+
+	scratch->n = 0;
+	job->font.font.userdata = scratch;
+	if (job->sdf) {
+		fons__distanceField(&job->font, job->glyph, job->size, job->scale, job->xoff, job->yoff,
+							job->bitmap, job->width, job->height, job->width);
+		return;
+	}
+	fons__tt_renderGlyphBitmap(&job->font, &job->bitmap[pad + pad*job->width], job->width-pad*2, job->height-pad*2,
+							   job->width, job->scale, job->scale, job->glyph);
+	if (job->blur > 0) {
+		scratch->n = 0;
+		fons__blur(NULL, job->bitmap, job->width, job->height, job->width, job->blur);
+	}
+}
+
+static void fons__workerLoop(FONSworkers* w)
+{
+	FONSscratch scratch;
+	scratch.data = (unsigned char*)malloc(FONS_SCRATCH_BUF_SIZE);
+	scratch.n = 0;
+	scratch.stash = NULL;
+	scratch.coverage = NULL;
+	scratch.ccoverage = 0;
+
+	fons__lock(&w->lock);
+	for (;;) {
+		FONSjob* job;
+		while (w->queue == NULL && !w->quit)
+			fons__condWait(&w->start, &w->lock);
+		if (w->quit) break;
+		job = w->queue;
+		w->queue = job->next;
+		if (w->queue == NULL) w->queueTail = NULL;
+		fons__unlock(&w->lock);
+
+		fons__rasterizeJob(job, &scratch);
+
+		fons__lock(&w->lock);
+		job->next = w->finished;
+		w->finished = job;
+		w->pending--;
+		fons__condBroadcast(&w->done);
+	}
+	fons__unlock(&w->lock);
+
+	free(scratch.data);
+	free(scratch.coverage);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI fons__worker(LPVOID arg) { fons__workerLoop((FONSworkers*)arg); return 0; }
+#else
+static void* fons__worker(void* arg) { fons__workerLoop((FONSworkers*)arg); return NULL; }
+#endif
+
+static void fons__freeJobs(FONSjob* job)
+{
+	while (job != NULL) {
+		FONSjob* next = job->next;
+		free(job->bitmap);
+		free(job);
+		job = next;
+	}
+}
+
+static void fons__deleteWorkers(FONSworkers* w)
+{
+	int i;
+	if (w == NULL) return;
+
+	fons__lock(&w->lock);
+	w->quit = 1;
+	fons__condBroadcast(&w->start);
+	fons__unlock(&w->lock);
+
+	for (i = 0; i < w->nthreads; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(w->threads[i], INFINITE);
+		CloseHandle(w->threads[i]);
+#else
+		pthread_join(w->threads[i], NULL);
+#endif
+	}
+
+	fons__freeJobs(w->queue);
+	fons__freeJobs(w->finished);
+	fons__condDestroy(&w->start);
+	fons__condDestroy(&w->done);
+	fons__mutexDestroy(&w->lock);
+	free(w->threads);
+	free(w);
+}
+
+static FONSworkers* fons__createWorkers(int nthreads)
+{
+	FONSworkers* w = (FONSworkers*)malloc(sizeof(FONSworkers));
+	if (w == NULL) return NULL;
+	memset(w, 0, sizeof(FONSworkers));
+
+	w->threads = (FONSthread*)malloc(sizeof(FONSthread) * nthreads);
+	if (w->threads == NULL) {
+		free(w);
+		return NULL;
+	}
+
+	fons__mutexInit(&w->lock);
+	fons__condInit(&w->start);
+	fons__condInit(&w->done);
+
+	for (w->nthreads = 0; w->nthreads < nthreads; w->nthreads++) {
+#ifdef _WIN32
+		w->threads[w->nthreads] = CreateThread(NULL, 0, fons__worker, w, 0, NULL);
+		if (w->threads[w->nthreads] == NULL) break;
+#else
+		if (pthread_create(&w->threads[w->nthreads], NULL, fons__worker, w) != 0) break;
+#endif
+	}
+
+	if (w->nthreads == 0) {
+		fons__deleteWorkers(w);
+		return NULL;
+	}
+
+	return w;
+}
+
+static int fons__queueGlyph(FONScontext* stash, FONSfont* font, int glyphIdx, int g, float size, float scale, int pad, int blur)
+{
+	FONSworkers* w = stash->workers;
+	FONSglyph* glyph = &font->glyphs[glyphIdx];
+	FONSjob* job;
+	int i, fontIdx = -1;
+
+	for (i = 0; i < stash->nfonts; i++) {
+		if (stash->fonts[i] == font) {
+			fontIdx = i;
+			break;
+		}
+	}
+	if (fontIdx == -1) return 0;
+
+	job = (FONSjob*)malloc(sizeof(FONSjob));
+	if (job == NULL) return 0;
+	memset(job, 0, sizeof(FONSjob));
+	job->font = font->font;
+	job->fontIdx = fontIdx;
+	job->glyphIdx = glyphIdx;
+	job->generation = stash->generation;
+	job->glyph = g;
+	job->width = glyph->x1 - glyph->x0;
+	job->height = glyph->y1 - glyph->y0;
+	job->pad = pad;
+	job->blur = blur;
+	job->sdf = glyph->sdf;
+	job->xoff = glyph->xoff;
+	job->yoff = glyph->yoff;
+	job->size = size;
+	job->scale = scale;
+
+	fons__lock(&w->lock);
+	if (w->queueTail != NULL)
+		w->queueTail->next = job;
+	else
+		w->queue = job;
+	w->queueTail = job;
+	w->pending++;
+	fons__condBroadcast(&w->start);
+	fons__unlock(&w->lock);
+
+	glyph->pending = 1;
+	return 1;
+}
+
+#endif // FONS_THREADS
+
+int fonsSetThreads(FONScontext* stash, int nthreads)
+{
+#ifdef FONS_THREADS
+	if (stash->workers != NULL) {
+		fonsUpdatePending(stash, 1);
+		fons__deleteWorkers(stash->workers);
+		stash->workers = NULL;
+	}
+	if (nthreads <= 0) return 1;
+	stash->workers = fons__createWorkers(nthreads);
+	return stash->workers != NULL;
+#else
+	FONS_NOTUSED(stash);
+	return nthreads <= 0;
+#endif
+}
+
+int fonsUpdatePending(FONScontext* stash, int wait)
+{
+#ifdef FONS_THREADS
+	FONSworkers* w = stash->workers;
+	FONSjob* jobs;
+	FONSjob* job;
+	int n = 0;
+
+	if (w == NULL) return 0;
+
+	fons__lock(&w->lock);
+	while (wait && w->pending > 0)
+		fons__condWait(&w->done, &w->lock);
+	jobs = w->finished;
+	w->finished = NULL;
+	fons__unlock(&w->lock);
+
+	for (job = jobs; job != NULL; job = job->next) {
+		FONSglyph* glyph;
+		int y;
+		// The glyphs of an atlas that was reset since are gone.
+		if (job->generation != stash->generation) continue;
+		glyph = &stash->fonts[job->fontIdx]->glyphs[job->glyphIdx];
+		glyph->pending = 0;
+		if (job->bitmap == NULL) continue;
+		for (y = 0; y < job->height; y++)
+			memcpy(&stash->texData[glyph->x0 + (glyph->y0 + y) * stash->params.width], &job->bitmap[y * job->width], job->width);
+		stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
+		stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
+		stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
+		stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
+		n++;
+	}
+	fons__freeJobs(jobs);
+
+	return n;
+#else
+	FONS_NOTUSED(stash);
+	FONS_NOTUSED(wait);
+	return 0;
+#endif
+}
+
+static void fons__rebuildLut(FONSfont* font)
+{
+	int i;
+	fons__lutClear(&font->lut);
+	for (i = 0; i < font->nglyphs; i++) {
+		FONSglyph* glyph = &font->glyphs[i];
+		fons__lutInsert(&font->lut, glyph->codepoint, fons__glyphVariant(glyph->size, glyph->blur, glyph->sdf), i);
+	}
+}
+
+// Bits of the columns between x0 and x1.
+static unsigned int fons__atlasColumns(FONScontext* stash, int x0, int x1)
+{
+	int cw = stash->atlas->columnWidth;
+	int c0 = fons__mini(x0 / cw, FONS_ATLAS_COLUMNS-1);
+	int c1 = fons__mini((x1-1) / cw, FONS_ATLAS_COLUMNS-1);
+	unsigned int mask = 0;
+	for (; c0 <= c1; c0++)
+		mask |= 1u << c0;
+	return mask;
+}
+
+// Widens x0..x1 of the last page until no glyph crosses its ends, returns the number of glyphs in
+// it and the latest frame one of them was used in.
+static int fons__atlasColumn(FONScontext* stash, int* x0, int* x1, int* lastUse)
+{
+	int i, j, n, grown;
+	do {
+		grown = 0;
+		n = 0;
+		*lastUse = -1;
+		for (i = 0; i < stash->nfonts; i++) {
+			FONSfont* font = stash->fonts[i];
+			for (j = 0; j < font->nglyphs; j++) {
+				FONSglyph* glyph = &font->glyphs[j];
+				if (glyph->page != stash->npages || glyph->x0 >= *x1 || glyph->x1 <= *x0) continue;
+				if (glyph->x0 < *x0) { *x0 = glyph->x0; grown = 1; }
+				if (glyph->x1 > *x1) { *x1 = glyph->x1; grown = 1; }
+				*lastUse = fons__maxi(*lastUse, glyph->lastUse);
+				n++;
+			}
+		}
+	} while (grown);
+	return n;
+}
+
+// Sets the stamps of the given columns of a page to the current eviction stamp.
+static void fons__stampColumns(FONScontext* stash, int page, unsigned int columns)
+{
+	int* stamps = page < stash->npages ? stash->pages[page].stamps : stash->stamps;
+	int i;
+	for (i = 0; i < FONS_ATLAS_COLUMNS; i++) {
+		if (columns & (1u << i))
+			stamps[i] = stash->stamp;
+	}
+}
+
+// Drops the glyphs of the column of the last page used least recently, and not in this frame, and
+// frees it. Returns 0 if there is no such column.
+static int fons__evictColumn(FONScontext* stash)
+{
+	int cw = stash->atlas->columnWidth;
+	int i, j, n, x0, x1, lastUse, y;
+	int bestx0 = 0, bestx1 = 0, bestUse = -1;
+
+	for (i = 0; i*cw < stash->params.width; i++) {
+		x0 = i*cw;
+		x1 = fons__mini(x0 + cw, stash->params.width);
+		n = fons__atlasColumn(stash, &x0, &x1, &lastUse);
+		if (n == 0 || lastUse >= stash->frame) continue;
+		if (stash->pinnedFrame == stash->frame && (stash->pinnedColumns & fons__atlasColumns(stash, x0, x1)) != 0) continue;
+		if (bestUse == -1 || lastUse < bestUse) {
+			bestx0 = x0;
+			bestx1 = x1;
+			bestUse = lastUse;
+		}
+	}
+	if (bestUse == -1) return 0;
+
+	// Finished glyphs are looked up by index, which changes below.
+	fonsUpdatePending(stash, 1);
+
+	for (i = 0; i < stash->nfonts; i++) {
+		FONSfont* font = stash->fonts[i];
+		for (j = n = 0; j < font->nglyphs; j++) {
+			FONSglyph* glyph = &font->glyphs[j];
+			if (glyph->page == stash->npages && glyph->x0 < bestx1 && glyph->x1 > bestx0) continue;
+			font->glyphs[n++] = *glyph;
+		}
+		stash->nevictions += font->nglyphs - n;
+		font->nglyphs = n;
+		fons__rebuildLut(font);
+	}
+
+	// New glyphs are rasterized inside their padding, clear it. The texture is updated with them.
+	for (y = 0; y < stash->params.height; y++)
+		memset(&stash->texData[bestx0 + y * stash->params.width], 0, bestx1 - bestx0);
+	if (fons__atlasClear(stash->atlas, bestx0, bestx1) == 0)
+		return 0;
+	stash->atlas->column = bestx0 / stash->atlas->columnWidth;
+	if (bestx0 == 0)
+		fons__addWhiteRect(stash, 2,2);
+	stash->stamp++;
+	fons__stampColumns(stash, stash->npages, fons__atlasColumns(stash, bestx0, bestx1));
+
+	return 1;
+}
+
+static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
+								 short isize, short iblur, int sdf)
+{
+	int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, x, y;
+	float scale;
+	FONSglyph* glyph = NULL;
+	unsigned int variant;
+	float size;
+	int pad, added;
+	unsigned char* bdst;
+	unsigned char* dst;
+
+	// One distance field serves all sizes and blurs.
+	if (sdf) {
+		isize = FONS_SDF_SIZE*10;
+		iblur = 0;
+	}
+	size = isize/10.0f;
+
+	if (isize < 2) return NULL;
+	if (iblur > 20) iblur = 20;
+	pad = sdf ? FONS_SDF_PAD+1 : iblur+2;
+
+	// Reset allocator.
+	stash->scratch.n = 0;
+
+	// Find code point and size.
+	variant = fons__glyphVariant(isize, iblur, sdf);
+	i = fons__lutFind(&font->lut, codepoint, variant);
+	if (i != -1) {
+		font->glyphs[i].lastUse = stash->frame;
+		return &font->glyphs[i];
 	}
 
 	// Could not find glyph, create it.
+	stash->nmisses++;
+	FONS_TRACE_BEGIN("fons__getGlyph");
 	scale = fons__tt_getPixelHeightScale(&font->font, size);
-	g = fons__tt_getGlyphIndex(&font->font, codepoint);
+	g = fons__getGlyphIndex(font, codepoint);
 	fons__tt_buildGlyphBitmap(&font->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1);
 	gw = x1-x0 + pad*2;
 	gh = y1-y0 + pad*2;
 
 	// Find free spot for the rect in the atlas
 	added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
+	while (added == 0 && fons__evictColumn(stash))
+		added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
 	if (added == 0 && stash->handleError != NULL) {
 		// Atlas is full, let the user to resize the atlas (or not), and try again.
 		stash->handleError(stash->errorUptr, FONS_ATLAS_FULL, 0);
 		added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
 	}
-	if (added == 0) return NULL;
+	if (added == 0) {
+		FONS_TRACE_END("fons__getGlyph");
+		return NULL;
+	}
 
 	// Init glyph.
 	glyph = fons__allocGlyph(font);
@@ -1063,11 +2402,29 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	glyph->xadv = (short)(scale * advance * 10.0f);
 	glyph->xoff = (short)(x0 - pad);
 	glyph->yoff = (short)(y0 - pad);
-	glyph->next = 0;
+	glyph->pending = 0;
+	glyph->sdf = (short)sdf;
+	glyph->page = (short)stash->npages;
+	glyph->lastUse = stash->frame;
 
 	// Insert char to hash lookup.
-	glyph->next = font->lut[h];
-	font->lut[h] = font->nglyphs-1;
+	fons__lutInsert(&font->lut, codepoint, variant, font->nglyphs-1);
+
+#ifdef FONS_THREADS
+	// Leave empty glyphs to the code below, there is nothing to rasterize.
+	if (stash->workers != NULL && gw > pad*2 && gh > pad*2) {
+		if (fons__queueGlyph(stash, font, font->nglyphs-1, g, size, scale, pad, iblur)) {
+			FONS_TRACE_END("fons__getGlyph");
+			return glyph;
+		}
+	}
+#endif
+
+	if (sdf) {
+		dst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
+		fons__distanceField(&font->font, g, size, scale, glyph->xoff, glyph->yoff, dst, gw, gh, stash->params.width);
+		goto done;
+	}
 
 	// Rasterize
 	dst = &stash->texData[(glyph->x0+pad) + (glyph->y0+pad) * stash->params.width];
@@ -1096,28 +2453,122 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 
 	// Blur
 	if (iblur > 0) {
-		stash->nscratch = 0;
+		stash->scratch.n = 0;
 		bdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
 		fons__blur(stash, bdst, gw,gh, stash->params.width, iblur);
 	}
 
+done:
 	stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
 	stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
 	stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
 	stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
 
+	FONS_TRACE_END("fons__getGlyph");
+	return glyph;
+}
+
+static FONSglyph* fons__getGlyphMetrics(FONScontext* stash, FONSfont* font, unsigned int codepoint,
+										short isize, short iblur, int sdf)
+{
+	int i, g, advance, lsb, x0, y0, x1, y1, pad;
+	float scale, size;
+	FONSglyph* glyph = NULL;
+	unsigned int variant;
+
+	if (sdf) {
+		isize = FONS_SDF_SIZE*10;
+		iblur = 0;
+	}
+	size = isize/10.0f;
+
+	if (isize < 2) return NULL;
+	if (iblur > 20) iblur = 20;
+	pad = sdf ? FONS_SDF_PAD+1 : iblur+2;
+
+	// A glyph already in the atlas has the same metrics, but measuring does not keep it from eviction.
+	variant = fons__glyphVariant(isize, iblur, sdf);
+	i = fons__lutFind(&font->lut, codepoint, variant);
+	if (i != -1)
+		return &font->glyphs[i];
+	i = fons__lutFind(&font->mlut, codepoint, variant);
+	if (i != -1)
+		return &font->metrics[i];
+
+	if (font->nmetrics >= FONS_MAX_METRICS) {
+		fons__lutClear(&font->mlut);
+		font->nmetrics = 0;
+	}
+	if (font->nmetrics+1 > font->cmetrics) {
+		font->cmetrics = font->cmetrics == 0 ? 8 : font->cmetrics * 2;
+		font->metrics = (FONSglyph*)realloc(font->metrics, sizeof(FONSglyph) * font->cmetrics);
+		if (font->metrics == NULL) {
+			font->cmetrics = font->nmetrics = 0;
+			fons__lutClear(&font->mlut);
+			return NULL;
+		}
+	}
+
+	// Same box as fons__getGlyph() would pack, at the origin.
+	stash->scratch.n = 0;
+	scale = fons__tt_getPixelHeightScale(&font->font, size);
+	g = fons__getGlyphIndex(font, codepoint);
+	fons__tt_buildGlyphBitmap(&font->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1);
+
+	glyph = &font->metrics[font->nmetrics++];
+	memset(glyph, 0, sizeof(*glyph));
+	glyph->codepoint = codepoint;
+	glyph->size = isize;
+	glyph->blur = iblur;
+	glyph->index = g;
+	glyph->x1 = (short)(x1-x0 + pad*2);
+	glyph->y1 = (short)(y1-y0 + pad*2);
+	glyph->xadv = (short)(scale * advance * 10.0f);
+	glyph->xoff = (short)(x0 - pad);
+	glyph->yoff = (short)(y0 - pad);
+	glyph->sdf = (short)sdf;
+	glyph->page = -1;
+
+	fons__lutInsert(&font->mlut, codepoint, variant, font->nmetrics-1);
+
 	return glyph;
 }
 
+// Pairs are cached direct mapped, a colliding pair replaces the old one.
+static int fons__getKern(FONScontext* stash, FONSfont* font, int glyph1, int glyph2)
+{
+	unsigned int pair = (unsigned int)glyph1 << 16 | (unsigned int)(glyph2 & 0xffff);
+	FONSkern* k = &font->kern[fons__hashint(pair) & (FONS_KERN_CACHE_SIZE-1)];
+
+	stash->nkernLookups++;
+	if (k->pair == pair) {
+		stash->nkernHits++;
+		return k->adv;
+	}
+	k->pair = pair;
+	k->adv = fons__tt_getGlyphKernAdvance(&font->font, glyph1, glyph2);
+	return k->adv;
+}
+
 static void fons__getQuad(FONScontext* stash, FONSfont* font,
 						   int prevGlyphIndex, FONSglyph* glyph,
 						   float scale, float spacing, float* x, float* y, FONSquad* q)
 {
-	float rx,ry,xoff,yoff,x0,y0,x1,y1;
+	float rx,ry,xoff,yoff,x0,y0,x1,y1,w,h;
+	float itw = stash->itw, ith = stash->ith;
+	float f = 1.0f;
+
+	if (glyph->page >= 0 && glyph->page != stash->npages) {
+		itw = 1.0f / stash->pages[glyph->page].width;
+		ith = 1.0f / stash->pages[glyph->page].height;
+	}
 
 	if (prevGlyphIndex != -1) {
-		float adv = fons__tt_getGlyphKernAdvance(&font->font, prevGlyphIndex, glyph->index) * scale;
-		*x += (int)(adv + spacing + 0.5f);
+		float adv = fons__getKern(stash, font, prevGlyphIndex, glyph->index) * scale;
+		if (glyph->sdf)
+			*x += adv + spacing;
+		else
+			*x += (int)(adv + spacing + 0.5f);
 	}
 
 	// Each glyph has 2px border to allow good interpolation,
@@ -1129,36 +2580,58 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 	y0 = (float)(glyph->y0+1);
 	x1 = (float)(glyph->x1-1);
 	y1 = (float)(glyph->y1-1);
+	w = x1 - x0;
+	h = y1 - y0;
+
+	// Distance fields are scaled from their own size and not snapped to pixels.
+	if (glyph->sdf) {
+		f = scale / fons__tt_getPixelHeightScale(&font->font, glyph->size/10.0f);
+		xoff *= f;
+		yoff *= f;
+		w *= f;
+		h *= f;
+	}
 
 	if (stash->params.flags & FONS_ZERO_TOPLEFT) {
-		rx = (float)(int)(*x + xoff);
-		ry = (float)(int)(*y + yoff);
+		rx = *x + xoff;
+		ry = *y + yoff;
+		if (!glyph->sdf) {
+			rx = (float)(int)rx;
+			ry = (float)(int)ry;
+		}
 
 		q->x0 = rx;
 		q->y0 = ry;
-		q->x1 = rx + x1 - x0;
-		q->y1 = ry + y1 - y0;
+		q->x1 = rx + w;
+		q->y1 = ry + h;
 
-		q->s0 = x0 * stash->itw;
-		q->t0 = y0 * stash->ith;
-		q->s1 = x1 * stash->itw;
-		q->t1 = y1 * stash->ith;
+		q->s0 = x0 * itw;
+		q->t0 = y0 * ith;
+		q->s1 = x1 * itw;
+		q->t1 = y1 * ith;
 	} else {
-		rx = (float)(int)(*x + xoff);
-		ry = (float)(int)(*y - yoff);
+		rx = *x + xoff;
+		ry = *y - yoff;
+		if (!glyph->sdf) {
+			rx = (float)(int)rx;
+			ry = (float)(int)ry;
+		}
 
 		q->x0 = rx;
 		q->y0 = ry;
-		q->x1 = rx + x1 - x0;
-		q->y1 = ry - y1 + y0;
+		q->x1 = rx + w;
+		q->y1 = ry - h;
 
-		q->s0 = x0 * stash->itw;
-		q->t0 = y0 * stash->ith;
-		q->s1 = x1 * stash->itw;
-		q->t1 = y1 * stash->ith;
+		q->s0 = x0 * itw;
+		q->t0 = y0 * ith;
+		q->s1 = x1 * itw;
+		q->t1 = y1 * ith;
 	}
 
-	*x += (int)(glyph->xadv / 10.0f + 0.5f);
+	if (glyph->sdf)
+		*x += glyph->xadv / 10.0f * f;
+	else
+		*x += (int)(glyph->xadv / 10.0f + 0.5f);
 }
 
 static void fons__flush(FONScontext* stash)
@@ -1260,7 +2733,7 @@ float fonsDrawText(FONScontext* stash,
 	for (; str != end; ++str) {
 		if (fons__decutf8(&utf8state, &codepoint, *(const unsigned char*)str))
 			continue;
-		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur);
+		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, state->sdf);
 		if (glyph != NULL) {
 			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
 
@@ -1297,6 +2770,7 @@ int fonsTextIterInit(FONScontext* stash, FONStextIter* iter,
 
 	iter->isize = (short)(state->size*10.0f);
 	iter->iblur = (short)state->blur;
+	iter->sdf = state->sdf;
 	iter->scale = fons__tt_getPixelHeightScale(&iter->font->font, (float)iter->isize/10.0f);
 
 	// Align horizontally
@@ -1323,10 +2797,20 @@ int fonsTextIterInit(FONScontext* stash, FONStextIter* iter,
 	iter->end = end;
 	iter->codepoint = 0;
 	iter->prevGlyphIndex = -1;
+	iter->page = stash->npages;
 
 	return 1;
 }
 
+int fonsMeasureIterInit(FONScontext* stash, FONStextIter* iter,
+						float x, float y, const char* str, const char* end)
+{
+	if (!fonsTextIterInit(stash, iter, x, y, str, end))
+		return 0;
+	iter->measure = 1;
+	return 1;
+}
+
 int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, FONSquad* quad)
 {
 	FONSglyph* glyph = NULL;
@@ -1343,10 +2827,17 @@ int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, FONSquad* quad)
 		// Get glyph and quad
 		iter->x = iter->nextx;
 		iter->y = iter->nexty;
-		glyph = fons__getGlyph(stash, iter->font, iter->codepoint, iter->isize, iter->iblur);
-		if (glyph != NULL)
+		if (iter->measure)
+			glyph = fons__getGlyphMetrics(stash, iter->font, iter->codepoint, iter->isize, iter->iblur, iter->sdf);
+		else
+			glyph = fons__getGlyph(stash, iter->font, iter->codepoint, iter->isize, iter->iblur, iter->sdf);
+		if (glyph != NULL) {
 			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
+			if (glyph->page >= 0)
+				iter->page = glyph->page;
+		}
 		iter->prevGlyphIndex = glyph != NULL ? glyph->index : -1;
+		iter->pending = glyph != NULL ? glyph->pending : 0;
 		break;
 	}
 	iter->next = str;
@@ -1440,7 +2931,7 @@ float fonsTextBounds(FONScontext* stash,
 	for (; str != end; ++str) {
 		if (fons__decutf8(&utf8state, &codepoint, *(const unsigned char*)str))
 			continue;
-		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur);
+		glyph = fons__getGlyphMetrics(stash, font, codepoint, isize, iblur, state->sdf);
 		if (glyph != NULL) {
 			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
 			if (q.x0 < minx) minx = q.x0;
@@ -1554,6 +3045,8 @@ void fonsDeleteInternal(FONScontext* stash)
 	int i;
 	if (stash == NULL) return;
 
+	fonsSetThreads(stash, 0);
+
 	if (stash->params.renderDelete)
 		stash->params.renderDelete(stash->params.userPtr);
 
@@ -1563,7 +3056,11 @@ void fonsDeleteInternal(FONScontext* stash)
 	if (stash->atlas) fons__deleteAtlas(stash->atlas);
 	if (stash->fonts) free(stash->fonts);
 	if (stash->texData) free(stash->texData);
-	if (stash->scratch) free(stash->scratch);
+	for (i = 0; i < stash->npages; i++)
+		free(stash->pages[i].data);
+	if (stash->pages) free(stash->pages);
+	if (stash->scratch.data) free(stash->scratch.data);
+	if (stash->scratch.coverage) free(stash->scratch.coverage);
 	free(stash);
 }
 
@@ -1581,6 +3078,92 @@ void fonsGetAtlasSize(FONScontext* stash, int* width, int* height)
 	*height = stash->params.height;
 }
 
+int fonsGlyphMisses(FONScontext* stash)
+{
+	return stash->nmisses;
+}
+
+int fonsKernLookups(FONScontext* stash, int* hits)
+{
+	if (hits != NULL)
+		*hits = stash->nkernHits;
+	return stash->nkernLookups;
+}
+
+int fonsAtlasGeneration(FONScontext* stash)
+{
+	return stash->generation;
+}
+
+int fonsEvictionStamp(FONScontext* stash)
+{
+	return stash->stamp;
+}
+
+int fonsPageStamp(FONScontext* stash, int page, int x0, int x1)
+{
+	const int* stamps;
+	int cw, c0, c1, stamp = 0;
+
+	if (page < 0 || page > stash->npages) return stash->stamp;
+	if (page < stash->npages) {
+		stamps = stash->pages[page].stamps;
+		cw = fons__maxi(1, stash->pages[page].width / FONS_ATLAS_COLUMNS);
+	} else {
+		stamps = stash->stamps;
+		cw = stash->atlas->columnWidth;
+	}
+	if (x0 >= x1) return 0;
+
+	c0 = fons__mini(fons__maxi(x0, 0) / cw, FONS_ATLAS_COLUMNS-1);
+	c1 = fons__mini(fons__maxi(x1-1, 0) / cw, FONS_ATLAS_COLUMNS-1);
+	for (; c0 <= c1; c0++)
+		stamp = fons__maxi(stamp, stamps[c0]);
+	return stamp;
+}
+
+void fonsBeginFrame(FONScontext* stash)
+{
+	stash->frame++;
+}
+
+void fonsPinAtlas(FONScontext* stash, int page, int x0, int x1)
+{
+	if (page < stash->npages) {
+		stash->pages[page].pinnedFrame = stash->frame;
+		return;
+	}
+	if (stash->pinnedFrame != stash->frame) {
+		stash->pinnedFrame = stash->frame;
+		stash->pinnedColumns = 0;
+	}
+	if (x0 < x1)
+		stash->pinnedColumns |= fons__atlasColumns(stash, x0, x1);
+}
+
+int fonsGlyphEvictions(FONScontext* stash)
+{
+	return stash->nevictions;
+}
+
+static int fons__atlasUsed(FONSatlas* atlas)
+{
+	int i, used = 0;
+	for (i = 0; i < atlas->nnodes; i++)
+		used += atlas->nodes[i].width * atlas->nodes[i].y;
+	return used;
+}
+
+int fonsAtlasUsage(FONScontext* stash, int* width, int* height)
+{
+	int i, used = fons__atlasUsed(stash->atlas);
+	for (i = 0; i < stash->npages; i++)
+		used += stash->pages[i].used;
+	if (width != NULL) *width = stash->atlas->width;
+	if (height != NULL) *height = stash->atlas->height;
+	return used;
+}
+
 int fonsExpandAtlas(FONScontext* stash, int width, int height)
 {
 	int i, maxy = 0;
@@ -1639,7 +3222,7 @@ int fonsExpandAtlas(FONScontext* stash, int width, int height)
 
 int fonsResetAtlas(FONScontext* stash, int width, int height)
 {
-	int i, j;
+	int i;
 	if (stash == NULL) return 0;
 
 	// Flush pending glyphs.
@@ -1653,6 +3236,11 @@ int fonsResetAtlas(FONScontext* stash, int width, int height)
 
 	// Reset atlas
 	fons__atlasReset(stash->atlas, width, height);
+	stash->generation++;
+	memset(stash->stamps, 0, sizeof(stash->stamps));
+	for (i = 0; i < stash->npages; i++)
+		free(stash->pages[i].data);
+	stash->npages = 0;
 
 	// Clear texture data.
 	stash->texData = (unsigned char*)realloc(stash->texData, width * height);
@@ -1669,8 +3257,7 @@ int fonsResetAtlas(FONScontext* stash, int width, int height)
 	for (i = 0; i < stash->nfonts; i++) {
 		FONSfont* font = stash->fonts[i];
 		font->nglyphs = 0;
-		for (j = 0; j < FONS_HASH_LUT_SIZE; j++)
-			font->lut[j] = -1;
+		fons__lutClear(&font->lut);
 	}
 
 	stash->params.width = width;
@@ -1684,5 +3271,456 @@ int fonsResetAtlas(FONScontext* stash, int width, int height)
 	return 1;
 }
 
+// Starts the last page over in data, which is cleared.
+static void fons__resetPage(FONScontext* stash, unsigned char* data, int width, int height)
+{
+	fons__atlasReset(stash->atlas, width, height);
+	stash->texData = data;
+	memset(stash->texData, 0, width * height);
+
+	stash->dirtyRect[0] = width;
+	stash->dirtyRect[1] = height;
+	stash->dirtyRect[2] = 0;
+	stash->dirtyRect[3] = 0;
+
+	stash->params.width = width;
+	stash->params.height = height;
+	stash->itw = 1.0f/stash->params.width;
+	stash->ith = 1.0f/stash->params.height;
+	memset(stash->stamps, 0, sizeof(stash->stamps));
+
+	// Add white rect at 0,0 for debug drawing.
+	fons__addWhiteRect(stash, 2,2);
+}
+
+// Moves the last page to pages[i].
+static void fons__storePage(FONScontext* stash, int i)
+{
+	FONSpage* page = &stash->pages[i];
+	page->data = stash->texData;
+	page->width = stash->params.width;
+	page->height = stash->params.height;
+	page->used = fons__atlasUsed(stash->atlas);
+	page->pinnedFrame = stash->pinnedFrame;
+	memcpy(page->stamps, stash->stamps, sizeof(page->stamps));
+	stash->pinnedColumns = 0;
+}
+
+int fonsAddPage(FONScontext* stash, int width, int height)
+{
+	unsigned char* data;
+	if (stash == NULL) return -1;
+
+	// Pending glyphs are copied into the last page.
+	fonsUpdatePending(stash, 1);
+
+	if (stash->npages+1 > stash->cpages) {
+		int cpages = stash->cpages == 0 ? 4 : stash->cpages * 2;
+		FONSpage* pages = (FONSpage*)realloc(stash->pages, sizeof(FONSpage) * cpages);
+		if (pages == NULL) return -1;
+		stash->pages = pages;
+		stash->cpages = cpages;
+	}
+	data = (unsigned char*)malloc(width * height);
+	if (data == NULL) return -1;
+
+	fons__storePage(stash, stash->npages++);
+	fons__resetPage(stash, data, width, height);
+
+	return stash->npages;
+}
+
+int fonsReusePage(FONScontext* stash)
+{
+	int i, j, n, p, lastUse, best = -1, bestUse = 0;
+	FONSpage page;
+	if (stash == NULL) return -1;
+
+	for (p = 0; p < stash->npages; p++) {
+		lastUse = stash->pages[p].pinnedFrame;
+		for (i = 0; i < stash->nfonts; i++) {
+			FONSfont* font = stash->fonts[i];
+			for (j = 0; j < font->nglyphs; j++) {
+				if (font->glyphs[j].page == p)
+					lastUse = fons__maxi(lastUse, font->glyphs[j].lastUse);
+			}
+		}
+		if (lastUse >= stash->frame) continue;
+		if (best == -1 || lastUse < bestUse) {
+			best = p;
+			bestUse = lastUse;
+		}
+	}
+	if (best == -1) return -1;
+
+	// Finished glyphs are looked up by index, which changes below.
+	fonsUpdatePending(stash, 1);
+
+	for (i = 0; i < stash->nfonts; i++) {
+		FONSfont* font = stash->fonts[i];
+		for (j = n = 0; j < font->nglyphs; j++) {
+			FONSglyph* glyph = &font->glyphs[j];
+			if (glyph->page == best) continue;
+			if (glyph->page == stash->npages)
+				glyph->page = (short)best;
+			font->glyphs[n++] = *glyph;
+		}
+		stash->nevictions += font->nglyphs - n;
+		font->nglyphs = n;
+		fons__rebuildLut(font);
+	}
+
+	// The last page takes the place of the dropped one, and starts over in its memory.
+	page = stash->pages[best];
+	fons__storePage(stash, best);
+	fons__resetPage(stash, page.data, page.width, page.height);
+
+	// Both page indices now hold other glyphs.
+	stash->stamp++;
+	fons__stampColumns(stash, best, ~0u);
+	fons__stampColumns(stash, stash->npages, ~0u);
+
+	return best;
+}
+
+int fonsPageCount(FONScontext* stash)
+{
+	return stash->npages + 1;
+}
+
+const unsigned char* fonsGetPageData(FONScontext* stash, int page, int* width, int* height)
+{
+	if (page < stash->npages) {
+		if (width != NULL) *width = stash->pages[page].width;
+		if (height != NULL) *height = stash->pages[page].height;
+		return stash->pages[page].data;
+	}
+	return fonsGetTextureData(stash, width, height);
+}
+
+int fonsPageUsage(FONScontext* stash, int page, int* width, int* height)
+{
+	if (page < stash->npages) {
+		if (width != NULL) *width = stash->pages[page].width;
+		if (height != NULL) *height = stash->pages[page].height;
+		return stash->pages[page].used;
+	}
+	if (width != NULL) *width = stash->atlas->width;
+	if (height != NULL) *height = stash->atlas->height;
+	return fons__atlasUsed(stash->atlas);
+}
+
+#define FONS_CACHE_MAGIC	0x53434e46	// "FNCS" in little endian
+#define FONS_CACHE_VERSION	6
+
+struct FONScacheHeader {
+	unsigned int magic;
+	int version;
+	int glyphSize;
+	int width, height;
+	int nnodes;
+	int nfonts;
+	int npages;		// Full pages, stored after the last one.
+};
+typedef struct FONScacheHeader FONScacheHeader;
+
+struct FONScachePage {
+	int width, height;
+	int used;
+};
+typedef struct FONScachePage FONScachePage;
+
+struct FONScacheFont {
+	unsigned int hash;
+	int dataSize;
+	int nglyphs;
+};
+typedef struct FONScacheFont FONScacheFont;
+
+// FNV-1a of the sfnt table directory, which holds a checksum of every table. Hashing just
+// the directory keeps memory mapped fonts from being paged in. Collections are hashed whole.
+static unsigned int fons__fontHash(FONSfont* font)
+{
+	const unsigned char* data = font->data;
+	unsigned int hash = 2166136261u;
+	int i, n = font->dataSize;
+
+	if (n >= 12 && memcmp(data, "ttcf", 4) != 0) {
+		int ntables = (data[4] << 8) | data[5];
+		n = fons__mini(n, 12 + ntables*16);
+	}
+	for (i = 0; i < n; i++) {
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+unsigned char* fonsSaveCache(FONScontext* stash, int* size)
+{
+	FONSatlas* atlas = stash->atlas;
+	FONScacheHeader header;
+	unsigned char* data;
+	unsigned char* ptr;
+	size_t n;
+	int i;
+
+	// Pending glyphs have no pixels yet.
+	fonsUpdatePending(stash, 1);
+
+	n = sizeof(header) + sizeof(FONSatlasNode)*atlas->nnodes + (size_t)stash->params.width*stash->params.height;
+	for (i = 0; i < stash->npages; i++)
+		n += sizeof(FONScachePage) + (size_t)stash->pages[i].width*stash->pages[i].height;
+	for (i = 0; i < stash->nfonts; i++)
+		n += sizeof(FONScacheFont) + sizeof(FONSglyph)*stash->fonts[i]->nglyphs;
+	// The size is returned as an int.
+	if (n > 0x7fffffff) return NULL;
+
+	data = (unsigned char*)malloc(n);
+	if (data == NULL) return NULL;
+
+	header.magic = FONS_CACHE_MAGIC;
+	header.version = FONS_CACHE_VERSION;
+	header.glyphSize = sizeof(FONSglyph);
+	header.width = stash->params.width;
+	header.height = stash->params.height;
+	header.nnodes = atlas->nnodes;
+	header.nfonts = stash->nfonts;
+	header.npages = stash->npages;
+
+	ptr = data;
+	memcpy(ptr, &header, sizeof(header));
+	ptr += sizeof(header);
+	memcpy(ptr, atlas->nodes, sizeof(FONSatlasNode)*atlas->nnodes);
+	ptr += sizeof(FONSatlasNode)*atlas->nnodes;
+	memcpy(ptr, stash->texData, header.width*header.height);
+	ptr += header.width*header.height;
+
+	for (i = 0; i < stash->npages; i++) {
+		FONScachePage cp;
+		cp.width = stash->pages[i].width;
+		cp.height = stash->pages[i].height;
+		cp.used = stash->pages[i].used;
+		memcpy(ptr, &cp, sizeof(cp));
+		ptr += sizeof(cp);
+		memcpy(ptr, stash->pages[i].data, cp.width*cp.height);
+		ptr += cp.width*cp.height;
+	}
+
+	for (i = 0; i < stash->nfonts; i++) {
+		FONSfont* font = stash->fonts[i];
+		FONScacheFont cf;
+		cf.hash = fons__fontHash(font);
+		cf.dataSize = font->dataSize;
+		cf.nglyphs = font->nglyphs;
+		memcpy(ptr, &cf, sizeof(cf));
+		ptr += sizeof(cf);
+		memcpy(ptr, font->glyphs, sizeof(FONSglyph)*font->nglyphs);
+		ptr += sizeof(FONSglyph)*font->nglyphs;
+	}
+
+	*size = (int)n;
+	return data;
+}
+
+// Returns the cached glyph table of the font, or NULL.
+static const unsigned char* fons__findCacheFont(const unsigned char* ptr, int nfonts, unsigned int hash,
+												int dataSize, FONScacheFont* cf)
+{
+	int i;
+	for (i = 0; i < nfonts; i++) {
+		memcpy(cf, ptr, sizeof(*cf));
+		ptr += sizeof(*cf);
+		if (cf->hash == hash && cf->dataSize == dataSize)
+			return ptr;
+		ptr += sizeof(FONSglyph)*cf->nglyphs;
+	}
+	return NULL;
+}
+
+// Checks the skyline of the last page, it has to cover the page width from left to right.
+static int fons__validCacheNodes(const unsigned char* ptr, int nnodes, int width, int height)
+{
+	FONSatlasNode node;
+	int i, x = 0;
+	for (i = 0; i < nnodes; i++) {
+		memcpy(&node, ptr + sizeof(node)*i, sizeof(node));
+		if (node.x != x || node.width <= 0 || node.x + node.width > width) return 0;
+		if (node.y < 0 || node.y > height) return 0;
+		x = node.x + node.width;
+	}
+	return x == width;
+}
+
+// Checks that the glyphs of a cached font are finished and inside their pages. sizes holds the
+// width and height of every page, the last one included.
+static int fons__validCacheGlyphs(const unsigned char* ptr, int nglyphs, const int* sizes, int npages)
+{
+	FONSglyph glyph;
+	int i;
+	for (i = 0; i < nglyphs; i++) {
+		memcpy(&glyph, ptr + sizeof(glyph)*i, sizeof(glyph));
+		if (glyph.pending != 0) return 0;
+		if (glyph.page < 0 || glyph.page > npages) return 0;
+		if (glyph.x0 < 0 || glyph.x0 > glyph.x1 || glyph.x1 > sizes[glyph.page*2]) return 0;
+		if (glyph.y0 < 0 || glyph.y0 > glyph.y1 || glyph.y1 > sizes[glyph.page*2+1]) return 0;
+	}
+	return 1;
+}
+
+int fonsLoadCache(FONScontext* stash, const unsigned char* data, int size)
+{
+	FONSatlas* atlas = stash->atlas;
+	FONScacheHeader header;
+	FONScacheFont cf;
+	FONScachePage cp;
+	const unsigned char* pages;
+	const unsigned char* fonts;
+	const unsigned char* ptr;
+	unsigned int* hashes = NULL;
+	int* sizes = NULL;
+	size_t left;
+	int i, j, nmatches = 0;
+
+	// Validate the block. Sizes are checked against the bytes left, so they can not overflow.
+	if (data == NULL || size < (int)sizeof(header)) return 0;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != FONS_CACHE_MAGIC || header.version != FONS_CACHE_VERSION || header.glyphSize != (int)sizeof(FONSglyph))
+		return 0;
+	// Atlas coordinates are shorts.
+	if (header.width <= 0 || header.width > 32767 || header.height <= 0 || header.height > 32767)
+		return 0;
+	if (header.nnodes <= 0 || header.nnodes > size || header.nfonts < 0 || header.nfonts > size)
+		return 0;
+	// So are page indices.
+	if (header.npages < 0 || header.npages > 32766)
+		return 0;
+	ptr = data + sizeof(header);
+	left = (size_t)size - sizeof(header);
+	if ((size_t)header.nnodes > left / sizeof(FONSatlasNode)) return 0;
+	if (!fons__validCacheNodes(ptr, header.nnodes, header.width, header.height)) return 0;
+	ptr += sizeof(FONSatlasNode)*header.nnodes;
+	left -= sizeof(FONSatlasNode)*header.nnodes;
+	if ((size_t)header.width*header.height > left) return 0;
+	ptr += (size_t)header.width*header.height;
+	left -= (size_t)header.width*header.height;
+
+	sizes = (int*)malloc(sizeof(int) * 2 * (header.npages+1));
+	if (sizes == NULL) return 0;
+	pages = ptr;
+	for (i = 0; i < header.npages; i++) {
+		if (left < sizeof(cp)) goto invalid;
+		memcpy(&cp, ptr, sizeof(cp));
+		if (cp.width <= 0 || cp.width > 32767 || cp.height <= 0 || cp.height > 32767) goto invalid;
+		if (cp.used < 0 || cp.used > cp.width*cp.height) goto invalid;
+		if ((size_t)cp.width*cp.height > left - sizeof(cp)) goto invalid;
+		ptr += sizeof(cp) + (size_t)cp.width*cp.height;
+		left -= sizeof(cp) + (size_t)cp.width*cp.height;
+		sizes[i*2] = cp.width;
+		sizes[i*2+1] = cp.height;
+	}
+	sizes[header.npages*2] = header.width;
+	sizes[header.npages*2+1] = header.height;
+	fonts = ptr;
+	for (i = 0; i < header.nfonts; i++) {
+		if (left < sizeof(cf)) goto invalid;
+		memcpy(&cf, ptr, sizeof(cf));
+		ptr += sizeof(cf);
+		left -= sizeof(cf);
+		if (cf.nglyphs < 0 || (size_t)cf.nglyphs > left / sizeof(FONSglyph)) goto invalid;
+		if (!fons__validCacheGlyphs(ptr, cf.nglyphs, sizes, header.npages)) goto invalid;
+		ptr += sizeof(FONSglyph)*cf.nglyphs;
+		left -= sizeof(FONSglyph)*cf.nglyphs;
+	}
+	free(sizes);
+	if (left != 0) return 0;
+
+	// Match the fonts of the stash.
+	if (stash->nfonts == 0) return 0;
+	hashes = (unsigned int*)malloc(sizeof(unsigned int) * stash->nfonts);
+	if (hashes == NULL) return 0;
+	for (i = 0; i < stash->nfonts; i++) {
+		hashes[i] = fons__fontHash(stash->fonts[i]);
+		if (fons__findCacheFont(fonts, header.nfonts, hashes[i], stash->fonts[i]->dataSize, &cf) != NULL)
+			nmatches++;
+	}
+	if (nmatches == 0 || !fonsResetAtlas(stash, header.width, header.height)) {
+		free(hashes);
+		return 0;
+	}
+
+	// Atlas
+	ptr = data + sizeof(header);
+	if (header.nnodes > atlas->cnodes) {
+		FONSatlasNode* nodes = (FONSatlasNode*)realloc(atlas->nodes, sizeof(FONSatlasNode) * header.nnodes);
+		if (nodes == NULL) goto error;
+		atlas->nodes = nodes;
+		atlas->cnodes = header.nnodes;
+	}
+	memcpy(atlas->nodes, ptr, sizeof(FONSatlasNode)*header.nnodes);
+	atlas->nnodes = header.nnodes;
+	ptr += sizeof(FONSatlasNode)*header.nnodes;
+	memcpy(stash->texData, ptr, header.width*header.height);
+
+	stash->dirtyRect[0] = 0;
+	stash->dirtyRect[1] = 0;
+	stash->dirtyRect[2] = header.width;
+	stash->dirtyRect[3] = header.height;
+
+	// Full pages
+	if (header.npages > stash->cpages) {
+		FONSpage* p = (FONSpage*)realloc(stash->pages, sizeof(FONSpage) * header.npages);
+		if (p == NULL) goto error;
+		stash->pages = p;
+		stash->cpages = header.npages;
+	}
+	ptr = pages;
+	for (i = 0; i < header.npages; i++) {
+		FONSpage* page = &stash->pages[i];
+		memcpy(&cp, ptr, sizeof(cp));
+		ptr += sizeof(cp);
+		page->data = (unsigned char*)malloc(cp.width*cp.height);
+		if (page->data == NULL) goto error;
+		memcpy(page->data, ptr, cp.width*cp.height);
+		ptr += cp.width*cp.height;
+		page->width = cp.width;
+		page->height = cp.height;
+		page->used = cp.used;
+		page->pinnedFrame = 0;
+		memset(page->stamps, 0, sizeof(page->stamps));
+		stash->npages++;
+	}
+
+	// Glyphs
+	for (i = 0; i < stash->nfonts; i++) {
+		FONSfont* font = stash->fonts[i];
+		const unsigned char* glyphs = fons__findCacheFont(fonts, header.nfonts, hashes[i], font->dataSize, &cf);
+		if (glyphs == NULL) continue;
+		if (cf.nglyphs > font->cglyphs) {
+			FONSglyph* g = (FONSglyph*)realloc(font->glyphs, sizeof(FONSglyph) * cf.nglyphs);
+			if (g == NULL) goto error;
+			font->glyphs = g;
+			font->cglyphs = cf.nglyphs;
+		}
+		memcpy(font->glyphs, glyphs, sizeof(FONSglyph)*cf.nglyphs);
+		font->nglyphs = cf.nglyphs;
+		for (j = 0; j < font->nglyphs; j++)
+			font->glyphs[j].lastUse = 0;
+		fons__rebuildLut(font);
+	}
+
+	free(hashes);
+	return nmatches;
+
+error:
+	free(hashes);
+	fonsResetAtlas(stash, header.width, header.height);
+	return 0;
+
+invalid:
+	free(sizes);
+	return 0;
+}
+
 
 #endif
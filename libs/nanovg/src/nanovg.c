@@ -19,11 +19,24 @@
 #include <stdio.h>
 #include <math.h>
 #include "nanovg.h"
+#define FONS_TRACE_BEGIN(name) NVG_TRACE_BEGIN(name)
+#define FONS_TRACE_END(name) NVG_TRACE_END(name)
 #define FONTSTASH_IMPLEMENTATION
 #include "fontstash.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#if defined(NVG_PROFILE) || defined(NVG_TRACE)
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(disable: 4100)  // unreferenced formal parameter
 #pragma warning(disable: 4127)  // conditional expression is constant
@@ -33,7 +46,6 @@
 
 #define NVG_INIT_FONTIMAGE_SIZE  512
 #define NVG_MAX_FONTIMAGE_SIZE   2048
-#define NVG_MAX_FONTIMAGES       4
 
 #define NVG_INIT_COMMANDS_SIZE 256
 #define NVG_INIT_POINTS_SIZE 128
@@ -45,6 +57,20 @@
 
 #define NVG_COUNTOF(arr) (sizeof(arr) / sizeof(0[arr]))
 
+// With NVG_PROFILE the time between NVG_PROFILE_MARK() and NVG_PROFILE_PHASE()
+// is added to the given field of the frame stats, otherwise both compile to nothing.
+#ifdef NVG_PROFILE
+#define NVG_PROFILE_MARK(ctx) ((ctx)->profileMark = nvg__time())
+#define NVG_PROFILE_PHASE(ctx, phase) do { \
+		double t = nvg__time(); \
+		(ctx)->frame.phase += t - (ctx)->profileMark; \
+		(ctx)->profileMark = t; \
+	} while (0)
+#else
+#define NVG_PROFILE_MARK(ctx)
+#define NVG_PROFILE_PHASE(ctx, phase)
+#endif
+
 
 enum NVGcommands {
 	NVG_MOVETO = 0,
@@ -118,8 +144,94 @@ struct NVGcontext {
 	float fringeWidth;
 	float devicePxRatio;
 	struct FONScontext* fs;
-	int fontImages[NVG_MAX_FONTIMAGES];
-	int fontImageIdx;
+	int* fontImages;	// Texture of each page of the font atlas.
+	int nfontImages;
+	int cfontImages;
+	int drawCallCount;
+	int fillTriCount;
+	int strokeTriCount;
+	int textTriCount;
+	NVGframeStats frame;
+	NVGframeStats lastFrame;
+	double profileMark;
+	int glyphMisses;
+	int glyphEvictions;
+	int kernLookups;
+	int kernHits;
+	float fontSizeStep;
+	int fontSDF;
+	NVGdisplayList* recording;
+	NVGshape* shape;
+};
+
+// Fill or stroke geometry of a shape, tesselated with the scale and skew of the transform.
+struct NVGshapeTess {
+	int valid;
+	float scale[3];		// Upper triangular part of the QR decomposition of the transform.
+	float fringe;
+	float strokeWidth;
+	int lineCap;
+	int lineJoin;
+	float miterLimit;
+	NVGpath* paths;
+	int npaths;
+	int cpaths;
+	NVGvertex* verts;
+	int nverts;
+	int cverts;
+	float bounds[4];
+	// Geometry rotated and translated in place for drawing.
+	NVGpath* placedPaths;
+	NVGvertex* placedVerts;
+};
+typedef struct NVGshapeTess NVGshapeTess;
+
+struct NVGshape {
+	float* commands;
+	int ncommands;
+	int ccommands;
+	float invxform[6];
+	NVGshapeTess fill;
+	NVGshapeTess stroke;
+};
+
+enum NVGdisplayCallType {
+	NVG_DISPLAY_FILL,
+	NVG_DISPLAY_STROKE,
+	NVG_DISPLAY_TRIANGLES,
+};
+
+struct NVGdisplayCall {
+	int type;
+	NVGpaint paint;
+	NVGscissor scissor;
+	float fringe;
+	float strokeWidth;
+	float bounds[4];
+	int pathOffset;
+	int npaths;
+	int vertOffset;
+	int nverts;
+	int fontPage;		// Font atlas page and range of it the text quads sample.
+	float textU[2];
+};
+typedef struct NVGdisplayCall NVGdisplayCall;
+
+struct NVGdisplayList {
+	NVGdisplayCall* calls;
+	int ncalls;
+	int ccalls;
+	NVGpath* paths;
+	int* pathVerts;		// Offsets of the fill and stroke vertices of each path.
+	int npaths;
+	int cpaths;
+	NVGvertex* verts;
+	int nverts;
+	int cverts;
+	int hasText;
+	int skippedGlyphs;	// Text was recorded without its pending glyphs.
+	int fontAtlasGeneration;
+	int fontAtlasStamp;	// Eviction stamp when recording began, see fonsPageStamp().
 	int drawCallCount;
 	int fillTriCount;
 	int strokeTriCount;
@@ -144,6 +256,26 @@ static float nvg__signf(float a) { return a >= 0.0f ? 1.0f : -1.0f; }
 static float nvg__clampf(float a, float mn, float mx) { return a < mn ? mn : (a > mx ? mx : a); }
 static float nvg__cross(float dx0, float dy0, float dx1, float dy1) { return dx1*dy0 - dx0*dy1; }
 
+#if defined(NVG_PROFILE) || defined(NVG_TRACE)
+static double nvg__time(void)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER freq, t;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&t);
+	return (double)t.QuadPart * 1000.0 / (double)freq.QuadPart;
+#elif defined(__APPLE__)
+	static mach_timebase_info_data_t info;
+	if (info.denom == 0) mach_timebase_info(&info);
+	return (double)mach_absolute_time() * info.numer / info.denom * 1e-6;
+#else
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1000.0 + t.tv_nsec * 1e-6;
+#endif
+}
+#endif
+
 static float nvg__normalize(float *x, float* y)
 {
 	float d = nvg__sqrtf((*x)*(*x) + (*y)*(*y));
@@ -204,13 +336,10 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 {
 	FONSparams fontParams;
 	NVGcontext* ctx = (NVGcontext*)malloc(sizeof(NVGcontext));
-	int i;
 	if (ctx == NULL) goto error;
 	memset(ctx, 0, sizeof(NVGcontext));
 
 	ctx->params = *params;
-	for (i = 0; i < NVG_MAX_FONTIMAGES; i++)
-		ctx->fontImages[i] = 0;
 
 	ctx->commands = (float*)malloc(sizeof(float)*NVG_INIT_COMMANDS_SIZE);
 	if (!ctx->commands) goto error;
@@ -241,9 +370,12 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	if (ctx->fs == NULL) goto error;
 
 	// Create font texture
+	ctx->fontImages = (int*)malloc(sizeof(int) * 4);
+	if (ctx->fontImages == NULL) goto error;
+	ctx->cfontImages = 4;
 	ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, fontParams.width, fontParams.height, 0, NULL);
 	if (ctx->fontImages[0] == 0) goto error;
-	ctx->fontImageIdx = 0;
+	ctx->nfontImages = 1;
 
 	return ctx;
 
@@ -267,12 +399,9 @@ void nvgDeleteInternal(NVGcontext* ctx)
 	if (ctx->fs)
 		fonsDeleteInternal(ctx->fs);
 
-	for (i = 0; i < NVG_MAX_FONTIMAGES; i++) {
-		if (ctx->fontImages[i] != 0) {
-			nvgDeleteImage(ctx, ctx->fontImages[i]);
-			ctx->fontImages[i] = 0;
-		}
-	}
+	for (i = 0; i < ctx->nfontImages; i++)
+		nvgDeleteImage(ctx, ctx->fontImages[i]);
+	if (ctx->fontImages != NULL) free(ctx->fontImages);
 
 	if (ctx->params.renderDelete != NULL)
 		ctx->params.renderDelete(ctx->params.userPtr);
@@ -298,6 +427,15 @@ void nvgBeginFrame(NVGcontext* ctx, int windowWidth, int windowHeight, float dev
 	ctx->fillTriCount = 0;
 	ctx->strokeTriCount = 0;
 	ctx->textTriCount = 0;
+	memset(&ctx->frame, 0, sizeof(ctx->frame));
+	ctx->glyphMisses = fonsGlyphMisses(ctx->fs);
+	ctx->glyphEvictions = fonsGlyphEvictions(ctx->fs);
+	ctx->kernLookups = fonsKernLookups(ctx->fs, &ctx->kernHits);
+
+	// Glyphs rasterized in the background since the last frame, uploaded with the next text.
+	fonsUpdatePending(ctx->fs, 0);
+	// Glyphs not drawn since the last frame can make room for new ones.
+	fonsBeginFrame(ctx->fs);
 }
 
 void nvgCancelFrame(NVGcontext* ctx)
@@ -307,32 +445,44 @@ void nvgCancelFrame(NVGcontext* ctx)
 
 void nvgEndFrame(NVGcontext* ctx)
 {
+	NVG_PROFILE_MARK(ctx);
 	ctx->params.renderFlush(ctx->params.userPtr);
-	if (ctx->fontImageIdx != 0) {
-		int fontImage = ctx->fontImages[ctx->fontImageIdx];
-		int i, j, iw, ih;
-		// delete images that smaller than current one
-		if (fontImage == 0)
-			return;
-		nvgImageSize(ctx, fontImage, &iw, &ih);
-		for (i = j = 0; i < ctx->fontImageIdx; i++) {
-			if (ctx->fontImages[i] != 0) {
-				int nw, nh;
-				nvgImageSize(ctx, ctx->fontImages[i], &nw, &nh);
-				if (nw < iw || nh < ih)
-					nvgDeleteImage(ctx, ctx->fontImages[i]);
-				else
-					ctx->fontImages[j++] = ctx->fontImages[i];
-			}
-		}
-		// make current font image to first
-		ctx->fontImages[j++] = ctx->fontImages[0];
-		ctx->fontImages[0] = fontImage;
-		ctx->fontImageIdx = 0;
-		// clear all images after j
-		for (i = j; i < NVG_MAX_FONTIMAGES; i++)
-			ctx->fontImages[i] = 0;
-	}
+	NVG_PROFILE_PHASE(ctx, submitTime);
+
+	ctx->lastFrame = ctx->frame;
+	ctx->lastFrame.drawCallCount = ctx->drawCallCount;
+	ctx->lastFrame.fillTriCount = ctx->fillTriCount;
+	ctx->lastFrame.strokeTriCount = ctx->strokeTriCount;
+	ctx->lastFrame.textTriCount = ctx->textTriCount;
+	ctx->lastFrame.glyphMisses = fonsGlyphMisses(ctx->fs) - ctx->glyphMisses;
+	ctx->lastFrame.glyphEvictions = fonsGlyphEvictions(ctx->fs) - ctx->glyphEvictions;
+	ctx->lastFrame.kernLookups = fonsKernLookups(ctx->fs, &ctx->lastFrame.kernHits) - ctx->kernLookups;
+	ctx->lastFrame.kernHits -= ctx->kernHits;
+}
+
+void nvgFrameStats(NVGcontext* ctx, NVGframeStats* stats)
+{
+	*stats = ctx->lastFrame;
+}
+
+static NVGtraceCallback nvg__traceCallback = NULL;
+static void* nvg__traceUptr = NULL;
+
+void nvgSetTraceCallback(NVGtraceCallback callback, void* uptr)
+{
+	nvg__traceCallback = callback;
+	nvg__traceUptr = uptr;
+}
+
+void nvgTrace(const char* name, int begin)
+{
+#ifdef NVG_TRACE
+	if (nvg__traceCallback != NULL)
+		nvg__traceCallback(nvg__traceUptr, name, begin, nvg__time());
+#else
+	NVG_NOTUSED(name);
+	NVG_NOTUSED(begin);
+#endif
 }
 
 NVGcolor nvgRGB(unsigned char r, unsigned char g, unsigned char b)
@@ -960,42 +1110,24 @@ static float nvg__distPtSeg(float x, float y, float px, float py, float qx, floa
 	return dx*dx + dy*dy;
 }
 
-static void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
+static void nvg__transformCommands(float* vals, int nvals, const float* xform)
 {
-	NVGstate* state = nvg__getState(ctx);
-	int i;
-
-	if (ctx->ncommands+nvals > ctx->ccommands) {
-		float* commands;
-		int ccommands = ctx->ncommands+nvals + ctx->ccommands/2;
-		commands = (float*)realloc(ctx->commands, sizeof(float)*ccommands);
-		if (commands == NULL) return;
-		ctx->commands = commands;
-		ctx->ccommands = ccommands;
-	}
-
-	if ((int)vals[0] != NVG_CLOSE && (int)vals[0] != NVG_WINDING) {
-		ctx->commandx = vals[nvals-2];
-		ctx->commandy = vals[nvals-1];
-	}
-
-	// transform commands
-	i = 0;
+	int i = 0;
 	while (i < nvals) {
 		int cmd = (int)vals[i];
 		switch (cmd) {
 		case NVG_MOVETO:
-			nvgTransformPoint(&vals[i+1],&vals[i+2], state->xform, vals[i+1],vals[i+2]);
+			nvgTransformPoint(&vals[i+1],&vals[i+2], xform, vals[i+1],vals[i+2]);
 			i += 3;
 			break;
 		case NVG_LINETO:
-			nvgTransformPoint(&vals[i+1],&vals[i+2], state->xform, vals[i+1],vals[i+2]);
+			nvgTransformPoint(&vals[i+1],&vals[i+2], xform, vals[i+1],vals[i+2]);
 			i += 3;
 			break;
 		case NVG_BEZIERTO:
-			nvgTransformPoint(&vals[i+1],&vals[i+2], state->xform, vals[i+1],vals[i+2]);
-			nvgTransformPoint(&vals[i+3],&vals[i+4], state->xform, vals[i+3],vals[i+4]);
-			nvgTransformPoint(&vals[i+5],&vals[i+6], state->xform, vals[i+5],vals[i+6]);
+			nvgTransformPoint(&vals[i+1],&vals[i+2], xform, vals[i+1],vals[i+2]);
+			nvgTransformPoint(&vals[i+3],&vals[i+4], xform, vals[i+3],vals[i+4]);
+			nvgTransformPoint(&vals[i+5],&vals[i+6], xform, vals[i+5],vals[i+6]);
 			i += 7;
 			break;
 		case NVG_CLOSE:
@@ -1008,10 +1140,64 @@ static void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
 			i++;
 		}
 	}
+}
+
+static float* nvg__growShapeCommands(NVGshape* shape, int n)
+{
+	if (shape->ncommands+n > shape->ccommands) {
+		float* commands;
+		int ccommands = shape->ncommands+n + shape->ccommands/2;
+		commands = (float*)realloc(shape->commands, sizeof(float)*ccommands);
+		if (commands == NULL) return NULL;
+		shape->commands = commands;
+		shape->ccommands = ccommands;
+	}
+	return &shape->commands[shape->ncommands];
+}
+
+// Stores device space commands in the space the shape was started in.
+static void nvg__appendShapeCommands(NVGshape* shape, const float* vals, int nvals)
+{
+	float* dst = nvg__growShapeCommands(shape, nvals);
+	if (dst == NULL) return;
+	memcpy(dst, vals, nvals*sizeof(float));
+	nvg__transformCommands(dst, nvals, shape->invxform);
+	shape->ncommands += nvals;
+	shape->fill.valid = 0;
+	shape->stroke.valid = 0;
+}
+
+static void nvg__appendCommands(NVGcontext* ctx, float* vals, int nvals)
+{
+	NVGstate* state = nvg__getState(ctx);
+
+	NVG_PROFILE_MARK(ctx);
+
+	if (ctx->ncommands+nvals > ctx->ccommands) {
+		float* commands;
+		int ccommands = ctx->ncommands+nvals + ctx->ccommands/2;
+		commands = (float*)realloc(ctx->commands, sizeof(float)*ccommands);
+		if (commands == NULL) return;
+		ctx->commands = commands;
+		ctx->ccommands = ccommands;
+		ctx->frame.allocCount++;
+	}
+
+	if ((int)vals[0] != NVG_CLOSE && (int)vals[0] != NVG_WINDING) {
+		ctx->commandx = vals[nvals-2];
+		ctx->commandy = vals[nvals-1];
+	}
+
+	nvg__transformCommands(vals, nvals, state->xform);
+
+	if (ctx->shape != NULL)
+		nvg__appendShapeCommands(ctx->shape, vals, nvals);
 
 	memcpy(&ctx->commands[ctx->ncommands], vals, nvals*sizeof(float));
 
 	ctx->ncommands += nvals;
+
+	NVG_PROFILE_PHASE(ctx, appendTime);
 }
 
 
@@ -1038,6 +1224,7 @@ static void nvg__addPath(NVGcontext* ctx)
 		if (paths == NULL) return;
 		ctx->cache->paths = paths;
 		ctx->cache->cpaths = cpaths;
+		ctx->frame.allocCount++;
 	}
 	path = &ctx->cache->paths[ctx->cache->npaths];
 	memset(path, 0, sizeof(*path));
@@ -1075,6 +1262,7 @@ static void nvg__addPoint(NVGcontext* ctx, float x, float y, int flags)
 		if (points == NULL) return;
 		ctx->cache->points = points;
 		ctx->cache->cpoints = cpoints;
+		ctx->frame.allocCount++;
 	}
 
 	pt = &ctx->cache->points[ctx->cache->npoints];
@@ -1117,6 +1305,7 @@ static NVGvertex* nvg__allocTempVerts(NVGcontext* ctx, int nverts)
 		if (verts == NULL) return NULL;
 		ctx->cache->verts = verts;
 		ctx->cache->cverts = cverts;
+		ctx->frame.allocCount++;
 	}
 
 	return ctx->cache->verts;
@@ -2084,6 +2273,611 @@ void nvgDebugDumpPathCache(NVGcontext* ctx)
 	}
 }
 
+//
+// Display lists
+//
+
+NVGdisplayList* nvgCreateDisplayList(void)
+{
+	NVGdisplayList* list = (NVGdisplayList*)malloc(sizeof(NVGdisplayList));
+	if (list == NULL) return NULL;
+	memset(list, 0, sizeof(NVGdisplayList));
+	return list;
+}
+
+void nvgDeleteDisplayList(NVGdisplayList* list)
+{
+	if (list == NULL) return;
+	free(list->calls);
+	free(list->paths);
+	free(list->pathVerts);
+	free(list->verts);
+	free(list);
+}
+
+static NVGdisplayCall* nvg__allocDisplayCall(NVGdisplayList* list)
+{
+	NVGdisplayCall* call;
+	if (list->ncalls+1 > list->ccalls) {
+		NVGdisplayCall* calls;
+		int ccalls = nvg__maxi(list->ncalls+1, 128) + list->ccalls/2; // 1.5x Overallocate
+		calls = (NVGdisplayCall*)realloc(list->calls, sizeof(NVGdisplayCall)*ccalls);
+		if (calls == NULL) return NULL;
+		list->calls = calls;
+		list->ccalls = ccalls;
+	}
+	call = &list->calls[list->ncalls++];
+	memset(call, 0, sizeof(*call));
+	return call;
+}
+
+static int nvg__allocDisplayPaths(NVGdisplayList* list, int n)
+{
+	int ret;
+	if (list->npaths+n > list->cpaths) {
+		NVGpath* paths;
+		int* pathVerts;
+		int cpaths = nvg__maxi(list->npaths+n, 128) + list->cpaths/2; // 1.5x Overallocate
+		paths = (NVGpath*)realloc(list->paths, sizeof(NVGpath)*cpaths);
+		if (paths == NULL) return -1;
+		list->paths = paths;
+		pathVerts = (int*)realloc(list->pathVerts, sizeof(int)*2*cpaths);
+		if (pathVerts == NULL) return -1;
+		list->pathVerts = pathVerts;
+		list->cpaths = cpaths;
+	}
+	ret = list->npaths;
+	list->npaths += n;
+	return ret;
+}
+
+static int nvg__allocDisplayVerts(NVGdisplayList* list, int n)
+{
+	int ret;
+	if (list->nverts+n > list->cverts) {
+		NVGvertex* verts;
+		int cverts = nvg__maxi(list->nverts+n, 4096) + list->cverts/2; // 1.5x Overallocate
+		verts = (NVGvertex*)realloc(list->verts, sizeof(NVGvertex)*cverts);
+		if (verts == NULL) return -1;
+		list->verts = verts;
+		list->cverts = cverts;
+	}
+	ret = list->nverts;
+	list->nverts += n;
+	return ret;
+}
+
+static NVGdisplayCall* nvg__recordCall(NVGcontext* ctx, int type, NVGpaint* paint, NVGscissor* scissor,
+									   const NVGpath* paths, int npaths)
+{
+	NVGdisplayList* list = ctx->recording;
+	NVGdisplayCall* call;
+	int i, offset, nverts = 0;
+
+	for (i = 0; i < npaths; i++)
+		nverts += paths[i].nfill + paths[i].nstroke;
+
+	call = nvg__allocDisplayCall(list);
+	if (call == NULL) return NULL;
+	call->type = type;
+	call->paint = *paint;
+	call->scissor = *scissor;
+	call->pathOffset = nvg__allocDisplayPaths(list, npaths);
+	if (call->pathOffset == -1) goto error;
+	call->npaths = npaths;
+	offset = nvg__allocDisplayVerts(list, nverts);
+	if (offset == -1) goto error;
+
+	// Vertex pointers are resolved in nvgEndDisplayList(), the buffer may still move.
+	for (i = 0; i < npaths; i++) {
+		NVGpath* copy = &list->paths[call->pathOffset + i];
+		int* pathVerts = &list->pathVerts[(call->pathOffset + i)*2];
+		*copy = paths[i];
+		copy->fill = NULL;
+		copy->stroke = NULL;
+		pathVerts[0] = offset;
+		if (paths[i].nfill > 0)
+			memcpy(&list->verts[offset], paths[i].fill, sizeof(NVGvertex) * paths[i].nfill);
+		offset += paths[i].nfill;
+		pathVerts[1] = offset;
+		if (paths[i].nstroke > 0)
+			memcpy(&list->verts[offset], paths[i].stroke, sizeof(NVGvertex) * paths[i].nstroke);
+		offset += paths[i].nstroke;
+	}
+
+	return call;
+
+error:
+	// We get here if call alloc was ok, but something else is not.
+	// Roll back the last call to prevent drawing it.
+	if (list->ncalls > 0) list->ncalls--;
+	return NULL;
+}
+
+static void nvg__recordFill(NVGcontext* ctx, NVGpaint* paint, NVGscissor* scissor, float fringe,
+							const float* bounds, const NVGpath* paths, int npaths)
+{
+	NVGdisplayCall* call = nvg__recordCall(ctx, NVG_DISPLAY_FILL, paint, scissor, paths, npaths);
+	if (call == NULL) return;
+	call->fringe = fringe;
+	memcpy(call->bounds, bounds, sizeof(call->bounds));
+}
+
+static void nvg__recordStroke(NVGcontext* ctx, NVGpaint* paint, NVGscissor* scissor, float fringe,
+							  float strokeWidth, const NVGpath* paths, int npaths)
+{
+	NVGdisplayCall* call = nvg__recordCall(ctx, NVG_DISPLAY_STROKE, paint, scissor, paths, npaths);
+	if (call == NULL) return;
+	call->fringe = fringe;
+	call->strokeWidth = strokeWidth;
+}
+
+static void nvg__recordTriangles(NVGcontext* ctx, NVGpaint* paint, NVGscissor* scissor,
+								 const NVGvertex* verts, int nverts, int fontPage)
+{
+	NVGdisplayList* list = ctx->recording;
+	NVGdisplayCall* call = nvg__recordCall(ctx, NVG_DISPLAY_TRIANGLES, paint, scissor, NULL, 0);
+	int i;
+	if (call == NULL) return;
+	call->vertOffset = nvg__allocDisplayVerts(list, nverts);
+	if (call->vertOffset == -1) {
+		list->ncalls--;
+		return;
+	}
+	call->nverts = nverts;
+	memcpy(&list->verts[call->vertOffset], verts, sizeof(NVGvertex) * nverts);
+
+	// Text quads point into the font atlas, they are only valid until it is reset.
+	list->hasText = 1;
+	call->fontPage = fontPage;
+	call->textU[0] = 1.0f;
+	call->textU[1] = 0.0f;
+	for (i = 0; i < nverts; i++) {
+		call->textU[0] = nvg__minf(call->textU[0], verts[i].u);
+		call->textU[1] = nvg__maxf(call->textU[1], verts[i].u);
+	}
+}
+
+void nvgBeginDisplayList(NVGcontext* ctx, NVGdisplayList* list)
+{
+	list->ncalls = 0;
+	list->npaths = 0;
+	list->nverts = 0;
+	list->hasText = 0;
+	list->skippedGlyphs = 0;
+	list->fontAtlasGeneration = fonsAtlasGeneration(ctx->fs);
+	list->fontAtlasStamp = fonsEvictionStamp(ctx->fs);
+	list->drawCallCount = ctx->drawCallCount;
+	list->fillTriCount = ctx->fillTriCount;
+	list->strokeTriCount = ctx->strokeTriCount;
+	list->textTriCount = ctx->textTriCount;
+	ctx->recording = list;
+}
+
+// Returns 0 if the font atlas was reset, or glyphs were dropped from the atlas columns the text
+// quads of the list sample, since the list was recorded.
+static int nvg__displayListText(NVGcontext* ctx, NVGdisplayList* list)
+{
+	int i, w;
+	if (!list->hasText) return 1;
+	if (list->fontAtlasGeneration != fonsAtlasGeneration(ctx->fs)) return 0;
+	for (i = 0; i < list->ncalls; i++) {
+		NVGdisplayCall* call = &list->calls[i];
+		if (call->type != NVG_DISPLAY_TRIANGLES) continue;
+		fonsGetPageData(ctx->fs, call->fontPage, &w, NULL);
+		if (fonsPageStamp(ctx->fs, call->fontPage, (int)(call->textU[0] * w), (int)(call->textU[1] * w + 1.0f)) > list->fontAtlasStamp)
+			return 0;
+	}
+	return 1;
+}
+
+void nvgEndDisplayList(NVGcontext* ctx)
+{
+	NVGdisplayList* list = ctx->recording;
+	int i;
+	if (list == NULL) return;
+
+	for (i = 0; i < list->npaths; i++) {
+		list->paths[i].fill = &list->verts[list->pathVerts[i*2+0]];
+		list->paths[i].stroke = &list->verts[list->pathVerts[i*2+1]];
+	}
+
+	list->drawCallCount = ctx->drawCallCount - list->drawCallCount;
+	list->fillTriCount = ctx->fillTriCount - list->fillTriCount;
+	list->strokeTriCount = ctx->strokeTriCount - list->strokeTriCount;
+	list->textTriCount = ctx->textTriCount - list->textTriCount;
+
+	// A text atlas reset, or an eviction of glyphs the list samples, while recording invalidates
+	// the quads recorded before it.
+	if (!nvg__displayListText(ctx, list))
+		list->ncalls = 0;
+	// So does a glyph that was still being rasterized.
+	if (list->skippedGlyphs)
+		list->ncalls = 0;
+
+	ctx->recording = NULL;
+}
+
+int nvgDrawDisplayList(NVGcontext* ctx, NVGdisplayList* list)
+{
+	int i;
+
+	if (list == NULL || list->ncalls == 0) return 0;
+	if (!nvg__displayListText(ctx, list)) return 0;
+
+	NVG_PROFILE_MARK(ctx);
+	for (i = 0; i < list->ncalls; i++) {
+		NVGdisplayCall* call = &list->calls[i];
+		NVGpath* paths = &list->paths[call->pathOffset];
+		NVGvertex* verts = &list->verts[call->vertOffset];
+		if (call->type == NVG_DISPLAY_FILL) {
+			ctx->params.renderFill(ctx->params.userPtr, &call->paint, &call->scissor, call->fringe,
+								   call->bounds, paths, call->npaths);
+			if (ctx->recording != NULL)
+				nvg__recordFill(ctx, &call->paint, &call->scissor, call->fringe, call->bounds, paths, call->npaths);
+		} else if (call->type == NVG_DISPLAY_STROKE) {
+			ctx->params.renderStroke(ctx->params.userPtr, &call->paint, &call->scissor, call->fringe,
+									 call->strokeWidth, paths, call->npaths);
+			if (ctx->recording != NULL)
+				nvg__recordStroke(ctx, &call->paint, &call->scissor, call->fringe, call->strokeWidth, paths, call->npaths);
+		} else if (call->type == NVG_DISPLAY_TRIANGLES) {
+			// The glyphs of the quads are not looked up, keep them in the atlas for this frame.
+			int w;
+			fonsGetPageData(ctx->fs, call->fontPage, &w, NULL);
+			fonsPinAtlas(ctx->fs, call->fontPage, (int)(call->textU[0] * w), (int)(call->textU[1] * w + 1.0f));
+			ctx->params.renderTriangles(ctx->params.userPtr, &call->paint, &call->scissor, verts, call->nverts);
+			if (ctx->recording != NULL)
+				nvg__recordTriangles(ctx, &call->paint, &call->scissor, verts, call->nverts, call->fontPage);
+		}
+	}
+	NVG_PROFILE_PHASE(ctx, submitTime);
+
+	ctx->drawCallCount += list->drawCallCount;
+	ctx->fillTriCount += list->fillTriCount;
+	ctx->strokeTriCount += list->strokeTriCount;
+	ctx->textTriCount += list->textTriCount;
+
+	return 1;
+}
+
+// Returns the stroke width in device pixels and the stroke paint with global alpha applied.
+static float nvg__strokeStyle(NVGcontext* ctx, NVGpaint* strokePaint)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getAverageScale(state->xform);
+	float strokeWidth = nvg__clampf(state->strokeWidth * scale, 0.0f, 200.0f);
+
+	*strokePaint = state->stroke;
+
+	if (strokeWidth < ctx->fringeWidth) {
+		// If the stroke width is less than pixel size, use alpha to emulate coverage.
+		// Since coverage is area, scale by alpha*alpha.
+		float alpha = nvg__clampf(strokeWidth / ctx->fringeWidth, 0.0f, 1.0f);
+		strokePaint->innerColor.a *= alpha*alpha;
+		strokePaint->outerColor.a *= alpha*alpha;
+		strokeWidth = ctx->fringeWidth;
+	}
+
+	// Apply global alpha
+	strokePaint->innerColor.a *= state->alpha;
+	strokePaint->outerColor.a *= state->alpha;
+
+	return strokeWidth;
+}
+
+//
+// Shapes
+//
+
+NVGshape* nvgCreateShape(void)
+{
+	NVGshape* shape = (NVGshape*)malloc(sizeof(NVGshape));
+	if (shape == NULL) return NULL;
+	memset(shape, 0, sizeof(NVGshape));
+	nvgTransformIdentity(shape->invxform);
+	return shape;
+}
+
+static void nvg__freeShapeTess(NVGshapeTess* tess)
+{
+	free(tess->paths);
+	free(tess->verts);
+	free(tess->placedPaths);
+	free(tess->placedVerts);
+}
+
+void nvgDeleteShape(NVGshape* shape)
+{
+	if (shape == NULL) return;
+	free(shape->commands);
+	nvg__freeShapeTess(&shape->fill);
+	nvg__freeShapeTess(&shape->stroke);
+	free(shape);
+}
+
+void nvgBeginShape(NVGcontext* ctx, NVGshape* shape)
+{
+	NVGstate* state = nvg__getState(ctx);
+	nvgBeginPath(ctx);
+	shape->ncommands = 0;
+	shape->fill.valid = 0;
+	shape->stroke.valid = 0;
+	if (nvgTransformInverse(shape->invxform, state->xform) == 0)
+		nvgTransformIdentity(shape->invxform);
+	ctx->shape = shape;
+}
+
+void nvgEndShape(NVGcontext* ctx)
+{
+	ctx->shape = NULL;
+}
+
+// Splits the transform of the shape into rotation*scale, the scale part [sx,shear,sy]
+// is what the tesselation depends on.
+static void nvg__shapeTransform(const float* xform, float* scale, float* rotation)
+{
+	float r = nvg__sqrtf(xform[0]*xform[0] + xform[1]*xform[1]);
+	float c = 1.0f, s = 0.0f;
+	if (r > 1e-6f) {
+		c = xform[0] / r;
+		s = xform[1] / r;
+	}
+	scale[0] = r;
+	scale[1] = c*xform[2] + s*xform[3];
+	scale[2] = -s*xform[2] + c*xform[3];
+	rotation[0] = c;
+	rotation[1] = s;
+}
+
+static int nvg__nearlyEqual(float a, float b)
+{
+	return nvg__absf(a - b) <= 1e-4f * nvg__maxf(1.0f, nvg__absf(a));
+}
+
+static int nvg__shapeTessValid(NVGshapeTess* tess, const float* scale, float fringe, float strokeWidth,
+							   int lineCap, int lineJoin, float miterLimit)
+{
+	return tess->valid &&
+		nvg__nearlyEqual(tess->scale[0], scale[0]) &&
+		nvg__nearlyEqual(tess->scale[1], scale[1]) &&
+		nvg__nearlyEqual(tess->scale[2], scale[2]) &&
+		tess->fringe == fringe &&
+		nvg__nearlyEqual(tess->strokeWidth, strokeWidth) &&
+		tess->lineCap == lineCap &&
+		tess->lineJoin == lineJoin &&
+		tess->miterLimit == miterLimit;
+}
+
+// Flattens and expands the shape with the scale part of the transform, and keeps the result.
+static int nvg__tesselateShape(NVGcontext* ctx, NVGshape* shape, NVGshapeTess* tess, int stroke,
+							   const float* scale, float strokeWidth, int lineCap, int lineJoin, float miterLimit)
+{
+	NVGpathCache* cache = ctx->cache;
+	float xform[6];
+	float* commands = ctx->commands;
+	int ncommands = ctx->ncommands;
+	int ccommands = ctx->ccommands;
+	float* scaled;
+	int i, nverts, offset;
+
+	tess->valid = 0;
+
+	// Tesselate from a scaled copy of the commands, the current path is put back after.
+	scaled = (float*)malloc(sizeof(float)*nvg__maxi(shape->ncommands, 1));
+	if (scaled == NULL) return 0;
+	memcpy(scaled, shape->commands, sizeof(float)*shape->ncommands);
+	xform[0] = scale[0]; xform[1] = 0.0f;
+	xform[2] = scale[1]; xform[3] = scale[2];
+	xform[4] = 0.0f; xform[5] = 0.0f;
+	nvg__transformCommands(scaled, shape->ncommands, xform);
+
+	ctx->commands = scaled;
+	ctx->ncommands = shape->ncommands;
+	ctx->ccommands = shape->ncommands;
+	nvg__clearPathCache(ctx);
+
+	NVG_PROFILE_MARK(ctx);
+	NVG_TRACE_BEGIN("nvg__flattenPaths");
+	nvg__flattenPaths(ctx);
+	NVG_TRACE_END("nvg__flattenPaths");
+	NVG_PROFILE_PHASE(ctx, flattenTime);
+	if (stroke) {
+		NVG_TRACE_BEGIN("nvg__expandStroke");
+		if (ctx->params.edgeAntiAlias)
+			nvg__expandStroke(ctx, strokeWidth*0.5f + ctx->fringeWidth*0.5f, lineCap, lineJoin, miterLimit);
+		else
+			nvg__expandStroke(ctx, strokeWidth*0.5f, lineCap, lineJoin, miterLimit);
+		NVG_TRACE_END("nvg__expandStroke");
+	} else {
+		NVG_TRACE_BEGIN("nvg__expandFill");
+		if (ctx->params.edgeAntiAlias)
+			nvg__expandFill(ctx, ctx->fringeWidth, NVG_MITER, 2.4f);
+		else
+			nvg__expandFill(ctx, 0.0f, NVG_MITER, 2.4f);
+		NVG_TRACE_END("nvg__expandFill");
+	}
+	NVG_PROFILE_PHASE(ctx, expandTime);
+
+	ctx->commands = commands;
+	ctx->ncommands = ncommands;
+	ctx->ccommands = ccommands;
+	free(scaled);
+
+	// Keep the geometry.
+	nverts = 0;
+	for (i = 0; i < cache->npaths; i++)
+		nverts += cache->paths[i].nfill + cache->paths[i].nstroke;
+	if (cache->npaths > tess->cpaths) {
+		NVGpath* paths = (NVGpath*)realloc(tess->paths, sizeof(NVGpath)*cache->npaths);
+		NVGpath* placedPaths;
+		if (paths == NULL) goto error;
+		tess->paths = paths;
+		placedPaths = (NVGpath*)realloc(tess->placedPaths, sizeof(NVGpath)*cache->npaths);
+		if (placedPaths == NULL) goto error;
+		tess->placedPaths = placedPaths;
+		tess->cpaths = cache->npaths;
+		ctx->frame.allocCount++;
+	}
+	if (nverts > tess->cverts) {
+		NVGvertex* verts = (NVGvertex*)realloc(tess->verts, sizeof(NVGvertex)*nverts);
+		NVGvertex* placedVerts;
+		if (verts == NULL) goto error;
+		tess->verts = verts;
+		placedVerts = (NVGvertex*)realloc(tess->placedVerts, sizeof(NVGvertex)*nverts);
+		if (placedVerts == NULL) goto error;
+		tess->placedVerts = placedVerts;
+		tess->cverts = nverts;
+		ctx->frame.allocCount++;
+	}
+
+	offset = 0;
+	for (i = 0; i < cache->npaths; i++) {
+		NVGpath* src = &cache->paths[i];
+		NVGpath* dst = &tess->paths[i];
+		*dst = *src;
+		dst->fill = &tess->verts[offset];
+		if (src->nfill > 0)
+			memcpy(dst->fill, src->fill, sizeof(NVGvertex)*src->nfill);
+		offset += src->nfill;
+		dst->stroke = &tess->verts[offset];
+		if (src->nstroke > 0)
+			memcpy(dst->stroke, src->stroke, sizeof(NVGvertex)*src->nstroke);
+		offset += src->nstroke;
+	}
+	tess->npaths = cache->npaths;
+	tess->nverts = nverts;
+	memcpy(tess->bounds, cache->bounds, sizeof(tess->bounds));
+
+	tess->scale[0] = scale[0];
+	tess->scale[1] = scale[1];
+	tess->scale[2] = scale[2];
+	tess->fringe = ctx->fringeWidth;
+	tess->strokeWidth = strokeWidth;
+	tess->lineCap = lineCap;
+	tess->lineJoin = lineJoin;
+	tess->miterLimit = miterLimit;
+	tess->valid = 1;
+
+	// The path cache holds the shape now, make the current path flatten again.
+	nvg__clearPathCache(ctx);
+	return 1;
+
+error:
+	nvg__clearPathCache(ctx);
+	return 0;
+}
+
+// Rotates and translates the cached geometry into place.
+static void nvg__placeShape(NVGshapeTess* tess, const float* rotation, const float* xform, float* bounds)
+{
+	float c = rotation[0], s = rotation[1];
+	float tx = xform[4], ty = xform[5];
+	int i;
+
+	for (i = 0; i < tess->nverts; i++) {
+		const NVGvertex* src = &tess->verts[i];
+		NVGvertex* dst = &tess->placedVerts[i];
+		dst->x = c*src->x - s*src->y + tx;
+		dst->y = s*src->x + c*src->y + ty;
+		dst->u = src->u;
+		dst->v = src->v;
+	}
+	for (i = 0; i < tess->npaths; i++) {
+		NVGpath* dst = &tess->placedPaths[i];
+		*dst = tess->paths[i];
+		dst->fill = tess->placedVerts + (tess->paths[i].fill - tess->verts);
+		dst->stroke = tess->placedVerts + (tess->paths[i].stroke - tess->verts);
+	}
+
+	if (bounds != NULL) {
+		float corners[8];
+		corners[0] = tess->bounds[0]; corners[1] = tess->bounds[1];
+		corners[2] = tess->bounds[2]; corners[3] = tess->bounds[1];
+		corners[4] = tess->bounds[2]; corners[5] = tess->bounds[3];
+		corners[6] = tess->bounds[0]; corners[7] = tess->bounds[3];
+		bounds[0] = bounds[1] = 1e6f;
+		bounds[2] = bounds[3] = -1e6f;
+		for (i = 0; i < 4; i++) {
+			float x = c*corners[i*2] - s*corners[i*2+1] + tx;
+			float y = s*corners[i*2] + c*corners[i*2+1] + ty;
+			bounds[0] = nvg__minf(bounds[0], x);
+			bounds[1] = nvg__minf(bounds[1], y);
+			bounds[2] = nvg__maxf(bounds[2], x);
+			bounds[3] = nvg__maxf(bounds[3], y);
+		}
+	}
+}
+
+void nvgFillShape(NVGcontext* ctx, NVGshape* shape)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGshapeTess* tess = &shape->fill;
+	NVGpaint fillPaint = state->fill;
+	float scale[3], rotation[2], bounds[4];
+	int i;
+
+	nvg__shapeTransform(state->xform, scale, rotation);
+	if (!nvg__shapeTessValid(tess, scale, ctx->fringeWidth, 0.0f, 0, 0, 0.0f)) {
+		if (!nvg__tesselateShape(ctx, shape, tess, 0, scale, 0.0f, 0, 0, 0.0f))
+			return;
+	}
+
+	NVG_PROFILE_MARK(ctx);
+	nvg__placeShape(tess, rotation, state->xform, bounds);
+	NVG_PROFILE_PHASE(ctx, expandTime);
+
+	// Apply global alpha
+	fillPaint.innerColor.a *= state->alpha;
+	fillPaint.outerColor.a *= state->alpha;
+
+	ctx->params.renderFill(ctx->params.userPtr, &fillPaint, &state->scissor, ctx->fringeWidth,
+						   bounds, tess->placedPaths, tess->npaths);
+	if (ctx->recording != NULL)
+		nvg__recordFill(ctx, &fillPaint, &state->scissor, ctx->fringeWidth,
+						bounds, tess->placedPaths, tess->npaths);
+	NVG_PROFILE_PHASE(ctx, submitTime);
+
+	// Count triangles
+	for (i = 0; i < tess->npaths; i++) {
+		ctx->fillTriCount += tess->paths[i].nfill-2;
+		ctx->fillTriCount += tess->paths[i].nstroke-2;
+		ctx->drawCallCount += 2;
+	}
+}
+
+void nvgStrokeShape(NVGcontext* ctx, NVGshape* shape)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGshapeTess* tess = &shape->stroke;
+	NVGpaint strokePaint;
+	float strokeWidth = nvg__strokeStyle(ctx, &strokePaint);
+	float scale[3], rotation[2];
+	int i;
+
+	nvg__shapeTransform(state->xform, scale, rotation);
+	if (!nvg__shapeTessValid(tess, scale, ctx->fringeWidth, strokeWidth, state->lineCap, state->lineJoin, state->miterLimit)) {
+		if (!nvg__tesselateShape(ctx, shape, tess, 1, scale, strokeWidth, state->lineCap, state->lineJoin, state->miterLimit))
+			return;
+	}
+
+	NVG_PROFILE_MARK(ctx);
+	nvg__placeShape(tess, rotation, state->xform, NULL);
+	NVG_PROFILE_PHASE(ctx, expandTime);
+
+	ctx->params.renderStroke(ctx->params.userPtr, &strokePaint, &state->scissor, ctx->fringeWidth,
+							 strokeWidth, tess->placedPaths, tess->npaths);
+	if (ctx->recording != NULL)
+		nvg__recordStroke(ctx, &strokePaint, &state->scissor, ctx->fringeWidth,
+						  strokeWidth, tess->placedPaths, tess->npaths);
+	NVG_PROFILE_PHASE(ctx, submitTime);
+
+	// Count triangles
+	for (i = 0; i < tess->npaths; i++) {
+		ctx->strokeTriCount += tess->paths[i].nstroke-2;
+		ctx->drawCallCount++;
+	}
+}
+
 void nvgFill(NVGcontext* ctx)
 {
 	NVGstate* state = nvg__getState(ctx);
@@ -2091,11 +2885,18 @@ void nvgFill(NVGcontext* ctx)
 	NVGpaint fillPaint = state->fill;
 	int i;
 
+	NVG_PROFILE_MARK(ctx);
+	NVG_TRACE_BEGIN("nvg__flattenPaths");
 	nvg__flattenPaths(ctx);
+	NVG_TRACE_END("nvg__flattenPaths");
+	NVG_PROFILE_PHASE(ctx, flattenTime);
+	NVG_TRACE_BEGIN("nvg__expandFill");
 	if (ctx->params.edgeAntiAlias)
 		nvg__expandFill(ctx, ctx->fringeWidth, NVG_MITER, 2.4f);
 	else
 		nvg__expandFill(ctx, 0.0f, NVG_MITER, 2.4f);
+	NVG_TRACE_END("nvg__expandFill");
+	NVG_PROFILE_PHASE(ctx, expandTime);
 
 	// Apply global alpha
 	fillPaint.innerColor.a *= state->alpha;
@@ -2103,6 +2904,10 @@ void nvgFill(NVGcontext* ctx)
 
 	ctx->params.renderFill(ctx->params.userPtr, &fillPaint, &state->scissor, ctx->fringeWidth,
 						   ctx->cache->bounds, ctx->cache->paths, ctx->cache->npaths);
+	if (ctx->recording != NULL)
+		nvg__recordFill(ctx, &fillPaint, &state->scissor, ctx->fringeWidth,
+						ctx->cache->bounds, ctx->cache->paths, ctx->cache->npaths);
+	NVG_PROFILE_PHASE(ctx, submitTime);
 
 	// Count triangles
 	for (i = 0; i < ctx->cache->npaths; i++) {
@@ -2116,34 +2921,31 @@ void nvgFill(NVGcontext* ctx)
 void nvgStroke(NVGcontext* ctx)
 {
 	NVGstate* state = nvg__getState(ctx);
-	float scale = nvg__getAverageScale(state->xform);
-	float strokeWidth = nvg__clampf(state->strokeWidth * scale, 0.0f, 200.0f);
-	NVGpaint strokePaint = state->stroke;
+	NVGpaint strokePaint;
+	float strokeWidth = nvg__strokeStyle(ctx, &strokePaint);
 	const NVGpath* path;
 	int i;
 
-	if (strokeWidth < ctx->fringeWidth) {
-		// If the stroke width is less than pixel size, use alpha to emulate coverage.
-		// Since coverage is area, scale by alpha*alpha.
-		float alpha = nvg__clampf(strokeWidth / ctx->fringeWidth, 0.0f, 1.0f);
-		strokePaint.innerColor.a *= alpha*alpha;
-		strokePaint.outerColor.a *= alpha*alpha;
-		strokeWidth = ctx->fringeWidth;
-	}
-
-	// Apply global alpha
-	strokePaint.innerColor.a *= state->alpha;
-	strokePaint.outerColor.a *= state->alpha;
-
+	NVG_PROFILE_MARK(ctx);
+	NVG_TRACE_BEGIN("nvg__flattenPaths");
 	nvg__flattenPaths(ctx);
+	NVG_TRACE_END("nvg__flattenPaths");
+	NVG_PROFILE_PHASE(ctx, flattenTime);
 
+	NVG_TRACE_BEGIN("nvg__expandStroke");
 	if (ctx->params.edgeAntiAlias)
 		nvg__expandStroke(ctx, strokeWidth*0.5f + ctx->fringeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
 	else
 		nvg__expandStroke(ctx, strokeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
+	NVG_TRACE_END("nvg__expandStroke");
+	NVG_PROFILE_PHASE(ctx, expandTime);
 
 	ctx->params.renderStroke(ctx->params.userPtr, &strokePaint, &state->scissor, ctx->fringeWidth,
 							 strokeWidth, ctx->cache->paths, ctx->cache->npaths);
+	if (ctx->recording != NULL)
+		nvg__recordStroke(ctx, &strokePaint, &state->scissor, ctx->fringeWidth,
+						  strokeWidth, ctx->cache->paths, ctx->cache->npaths);
+	NVG_PROFILE_PHASE(ctx, submitTime);
 
 	// Count triangles
 	for (i = 0; i < ctx->cache->npaths; i++) {
@@ -2218,17 +3020,34 @@ static float nvg__quantize(float a, float d)
 	return ((int)(a / d + 0.5f)) * d;
 }
 
-static float nvg__getFontScale(NVGstate* state)
+static float nvg__getFontScale(NVGcontext* ctx, NVGstate* state)
 {
-	return nvg__minf(nvg__quantize(nvg__getAverageScale(state->xform), 0.01f), 4.0f);
+	float scale = nvg__minf(nvg__quantize(nvg__getAverageScale(state->xform), 0.01f), 4.0f) * ctx->devicePxRatio;
+	float size, k;
+
+	// Distance fields have one size, quads are scaled to the exact size.
+	if (ctx->fontSDF)
+		return nvg__getAverageScale(state->xform) * ctx->devicePxRatio;
+
+	if (ctx->fontSizeStep <= 1.0f || state->fontSize <= 0.0f)
+		return scale;
+
+	// Round the pixel size up to the next power of the step, glyphs are drawn scaled down from it.
+	size = state->fontSize * scale;
+	k = ceilf(logf(size) / logf(ctx->fontSizeStep) - 0.001f);
+	size = nvg__maxf(nvg__quantize(powf(ctx->fontSizeStep, k), 0.1f), 0.1f);
+
+	return size / state->fontSize;
 }
 
 static void nvg__flushTextTexture(NVGcontext* ctx)
 {
 	int dirty[4];
 
+	NVG_PROFILE_MARK(ctx);
+	NVG_TRACE_BEGIN("nvg__flushTextTexture");
 	if (fonsValidateTexture(ctx->fs, dirty)) {
-		int fontImage = ctx->fontImages[ctx->fontImageIdx];
+		int fontImage = ctx->fontImages[ctx->nfontImages-1];
 		// Update texture
 		if (fontImage != 0) {
 			int iw, ih;
@@ -2240,60 +3059,105 @@ static void nvg__flushTextTexture(NVGcontext* ctx)
 			ctx->params.renderUpdateTexture(ctx->params.userPtr, fontImage, x,y, w,h, data);
 		}
 	}
+	NVG_TRACE_END("nvg__flushTextTexture");
+	NVG_PROFILE_PHASE(ctx, submitTime);
 }
 
+// Continues the full font atlas on a page none of the text of this frame is drawn from, or on a new one.
 static int nvg__allocTextAtlas(NVGcontext* ctx)
 {
-	int iw, ih;
+	int iw, ih, page, image, last = ctx->nfontImages-1;
+
+	// Glyphs of the last page have to be in its texture before it is left.
+	fonsUpdatePending(ctx->fs, 1);
 	nvg__flushTextTexture(ctx);
-	if (ctx->fontImageIdx >= NVG_MAX_FONTIMAGES-1)
+
+	page = fonsReusePage(ctx->fs);
+	if (page != -1) {
+		image = ctx->fontImages[page];
+		ctx->fontImages[page] = ctx->fontImages[last];
+		ctx->fontImages[last] = image;
+		ctx->frame.atlasResets++;
+		return 1;
+	}
+
+	if (ctx->nfontImages+1 > ctx->cfontImages) {
+		int cfontImages = ctx->cfontImages * 2;
+		int* fontImages = (int*)realloc(ctx->fontImages, sizeof(int) * cfontImages);
+		if (fontImages == NULL) return 0;
+		ctx->fontImages = fontImages;
+		ctx->cfontImages = cfontImages;
+	}
+	nvgImageSize(ctx, ctx->fontImages[last], &iw, &ih);
+	if (iw > ih)
+		ih *= 2;
+	else
+		iw *= 2;
+	if (iw > NVG_MAX_FONTIMAGE_SIZE || ih > NVG_MAX_FONTIMAGE_SIZE)
+		iw = ih = NVG_MAX_FONTIMAGE_SIZE;
+	image = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, 0, NULL);
+	if (image == 0)
+		return 0;
+	if (fonsAddPage(ctx->fs, iw, ih) == -1) {
+		nvgDeleteImage(ctx, image);
 		return 0;
-	// if next fontImage already have a texture
-	if (ctx->fontImages[ctx->fontImageIdx+1] != 0)
-		nvgImageSize(ctx, ctx->fontImages[ctx->fontImageIdx+1], &iw, &ih);
-	else { // calculate the new font image size and create it.
-		nvgImageSize(ctx, ctx->fontImages[ctx->fontImageIdx], &iw, &ih);
-		if (iw > ih)
-			ih *= 2;
-		else
-			iw *= 2;
-		if (iw > NVG_MAX_FONTIMAGE_SIZE || ih > NVG_MAX_FONTIMAGE_SIZE)
-			iw = ih = NVG_MAX_FONTIMAGE_SIZE;
-		ctx->fontImages[ctx->fontImageIdx+1] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, 0, NULL);
 	}
-	++ctx->fontImageIdx;
-	fonsResetAtlas(ctx->fs, iw, ih);
+	ctx->fontImages[ctx->nfontImages++] = image;
+	ctx->frame.atlasResets++;
 	return 1;
 }
 
-static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts)
+static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts, int page)
 {
 	NVGstate* state = nvg__getState(ctx);
 	NVGpaint paint = state->fill;
 
 	// Render triangles.
-	paint.image = ctx->fontImages[ctx->fontImageIdx];
+	paint.image = ctx->fontImages[page];
 
 	// Apply global alpha
 	paint.innerColor.a *= state->alpha;
 	paint.outerColor.a *= state->alpha;
 
+	// Distance field glyphs: the edge is 1px wide at the drawn size, the blur widens it.
+	paint.distScale = 0.0f;
+	if (ctx->fontSDF) {
+		float scale = nvg__getFontScale(ctx, state);
+		float pixels = state->fontSize * scale / FONS_SDF_SIZE;
+		paint.distScale = 2.0f * FONS_SDF_PAD * pixels / (state->fontBlur * scale + 1.0f);
+	}
+
+	NVG_PROFILE_MARK(ctx);
 	ctx->params.renderTriangles(ctx->params.userPtr, &paint, &state->scissor, verts, nverts);
+	if (ctx->recording != NULL)
+		nvg__recordTriangles(ctx, &paint, &state->scissor, verts, nverts, page);
+	NVG_PROFILE_PHASE(ctx, submitTime);
 
 	ctx->drawCallCount++;
 	ctx->textTriCount += nverts/3;
 }
 
+// Glyphs missing from the atlas are rasterized while iterating, except by measuring iterators.
+static int nvg__textIterNext(NVGcontext* ctx, FONStextIter* iter, FONSquad* quad)
+{
+	int ret;
+	NVG_PROFILE_MARK(ctx);
+	ret = fonsTextIterNext(ctx->fs, iter, quad);
+	NVG_PROFILE_PHASE(ctx, glyphTime);
+	return ret;
+}
+
 float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char* end)
 {
 	NVGstate* state = nvg__getState(ctx);
 	FONStextIter iter, prevIter;
 	FONSquad q;
 	NVGvertex* verts;
-	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float scale = nvg__getFontScale(ctx, state);
 	float invscale = 1.0f / scale;
 	int cverts = 0;
 	int nverts = 0;
+	int page;
 
 	if (end == NULL)
 		end = string + strlen(string);
@@ -2312,21 +3176,37 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
 
 	fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end);
 	prevIter = iter;
-	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
+	page = iter.page;
+	while (nvg__textIterNext(ctx, &iter, &q)) {
 		float c[4*2];
 		if (iter.prevGlyphIndex == -1) { // can not retrieve glyph?
-			if (!nvg__allocTextAtlas(ctx))
-				break; // no memory :(
-			if (nverts != 0) {
-				nvg__renderText(ctx, verts, nverts);
+			if (nverts != 0) { // draw what we have from the current atlas first
+				nvg__flushTextTexture(ctx);
+				nvg__renderText(ctx, verts, nverts, page);
 				nverts = 0;
 			}
+			if (!nvg__allocTextAtlas(ctx))
+				break; // no memory :(
 			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
+			nvg__textIterNext(ctx, &iter, &q); // try again
 			if (iter.prevGlyphIndex == -1) // still can not find glyph?
 				break;
 		}
 		prevIter = iter;
+		// Still being rasterized in the background, skip it this frame.
+		if (iter.pending) {
+			if (ctx->recording != NULL)
+				ctx->recording->skippedGlyphs = 1;
+			continue;
+		}
+		// Glyphs on another page of the atlas go to another draw call.
+		if (iter.page != page) {
+			if (nverts != 0) {
+				nvg__renderText(ctx, verts, nverts, page);
+				nverts = 0;
+			}
+			page = iter.page;
+		}
 		// Trasnform corners.
 		nvgTransformPoint(&c[0],&c[1], state->xform, q.x0*invscale, q.y0*invscale);
 		nvgTransformPoint(&c[2],&c[3], state->xform, q.x1*invscale, q.y0*invscale);
@@ -2346,11 +3226,132 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
 	// TODO: add back-end bit to do this just once per frame. 
 	nvg__flushTextTexture(ctx);
 
-	nvg__renderText(ctx, verts, nverts);
+	nvg__renderText(ctx, verts, nverts, page);
 
 	return iter.x;
 }
 
+int nvgPrewarmText(NVGcontext* ctx, const char* string, const char* end)
+{
+	NVGstate* state = nvg__getState(ctx);
+	FONStextIter iter, prevIter;
+	FONSquad q;
+	float scale = nvg__getFontScale(ctx, state);
+	int misses = fonsGlyphMisses(ctx->fs);
+
+	if (end == NULL)
+		end = string + strlen(string);
+
+	if (state->fontId == FONS_INVALID) return 0;
+
+	fonsSetSize(ctx->fs, state->fontSize*scale);
+	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
+	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetAlign(ctx->fs, state->textAlign);
+	fonsSetFont(ctx->fs, state->fontId);
+
+	// Same as nvgText() without the geometry.
+	fonsTextIterInit(ctx->fs, &iter, 0, 0, string, end);
+	prevIter = iter;
+	while (nvg__textIterNext(ctx, &iter, &q)) {
+		if (iter.prevGlyphIndex == -1) {
+			if (!nvg__allocTextAtlas(ctx))
+				break;
+			iter = prevIter;
+			nvg__textIterNext(ctx, &iter, &q);
+			if (iter.prevGlyphIndex == -1)
+				break;
+		}
+		prevIter = iter;
+	}
+
+	fonsUpdatePending(ctx->fs, 1);
+	nvg__flushTextTexture(ctx);
+
+	return fonsGlyphMisses(ctx->fs) - misses;
+}
+
+int nvgFontAtlasUsage(NVGcontext* ctx, int* width, int* height)
+{
+	return fonsAtlasUsage(ctx->fs, width, height);
+}
+
+int nvgFontAtlasPages(NVGcontext* ctx)
+{
+	return fonsPageCount(ctx->fs);
+}
+
+int nvgFontAtlasPageUsage(NVGcontext* ctx, int page, int* width, int* height)
+{
+	return fonsPageUsage(ctx->fs, page, width, height);
+}
+
+int nvgGlyphThreads(NVGcontext* ctx, int nthreads)
+{
+	return fonsSetThreads(ctx->fs, nthreads);
+}
+
+void nvgFontSizeStep(NVGcontext* ctx, float step)
+{
+	ctx->fontSizeStep = step;
+}
+
+void nvgFontSDF(NVGcontext* ctx, int sdf)
+{
+	ctx->fontSDF = sdf;
+	fonsSetSDF(ctx->fs, sdf);
+}
+
+unsigned char* nvgSaveFontCache(NVGcontext* ctx, int* size)
+{
+	return fonsSaveCache(ctx->fs, size);
+}
+
+int nvgLoadFontCache(NVGcontext* ctx, const unsigned char* data, int size)
+{
+	int i, n, npages, w, h, iw, ih;
+	int* images = NULL;
+
+	nvg__flushTextTexture(ctx);
+
+	n = fonsLoadCache(ctx->fs, data, size);
+	if (n == 0) return 0;
+
+	// One texture for each page, the cache may come from a grown atlas. Full pages are
+	// uploaded as they are created, the last one by the flush below.
+	npages = fonsPageCount(ctx->fs);
+	images = (int*)malloc(sizeof(int) * npages);
+	if (images == NULL) goto error;
+	for (i = 0; i < npages; i++) {
+		const unsigned char* pixels = fonsGetPageData(ctx->fs, i, &w, &h);
+		images[i] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, w, h, 0, i < npages-1 ? pixels : NULL);
+		if (images[i] == 0) goto error;
+	}
+
+	for (i = 0; i < ctx->nfontImages; i++)
+		nvgDeleteImage(ctx, ctx->fontImages[i]);
+	free(ctx->fontImages);
+	ctx->fontImages = images;
+	ctx->nfontImages = ctx->cfontImages = npages;
+
+	nvg__flushTextTexture(ctx);
+
+	return n;
+
+error:
+	if (images != NULL) {
+		while (i-- > 0)
+			nvgDeleteImage(ctx, images[i]);
+		free(images);
+	}
+	// Back to an empty atlas in the first texture.
+	nvgImageSize(ctx, ctx->fontImages[0], &iw, &ih);
+	fonsResetAtlas(ctx->fs, iw, ih);
+	while (ctx->nfontImages > 1)
+		nvgDeleteImage(ctx, ctx->fontImages[--ctx->nfontImages]);
+	return 0;
+}
+
 void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth, const char* string, const char* end)
 {
 	NVGstate* state = nvg__getState(ctx);
@@ -2387,9 +3388,9 @@ void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth, const ch
 int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string, const char* end, NVGglyphPosition* positions, int maxPositions)
 {
 	NVGstate* state = nvg__getState(ctx);
-	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float scale = nvg__getFontScale(ctx, state);
 	float invscale = 1.0f / scale;
-	FONStextIter iter, prevIter;
+	FONStextIter iter;
 	FONSquad q;
 	int npos = 0;
 
@@ -2407,14 +3408,8 @@ int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string,
 	fonsSetAlign(ctx->fs, state->textAlign);
 	fonsSetFont(ctx->fs, state->fontId);
 
-	fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end);
-	prevIter = iter;
-	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		if (iter.prevGlyphIndex < 0 && nvg__allocTextAtlas(ctx)) { // can not retrieve glyph?
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-		}
-		prevIter = iter;
+	fonsMeasureIterInit(ctx->fs, &iter, x*scale, y*scale, string, end);
+	while (nvg__textIterNext(ctx, &iter, &q)) {
 		positions[npos].str = iter.str;
 		positions[npos].x = iter.x * invscale;
 		positions[npos].minx = nvg__minf(iter.x, q.x0) * invscale;
@@ -2436,9 +3431,9 @@ enum NVGcodepointType {
 int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows)
 {
 	NVGstate* state = nvg__getState(ctx);
-	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float scale = nvg__getFontScale(ctx, state);
 	float invscale = 1.0f / scale;
-	FONStextIter iter, prevIter;
+	FONStextIter iter;
 	FONSquad q;
 	int nrows = 0;
 	float rowStartX = 0;
@@ -2472,14 +3467,8 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 
 	breakRowWidth *= scale;
 
-	fonsTextIterInit(ctx->fs, &iter, 0, 0, string, end);
-	prevIter = iter;
-	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		if (iter.prevGlyphIndex < 0 && nvg__allocTextAtlas(ctx)) { // can not retrieve glyph?
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-		}
-		prevIter = iter;
+	fonsMeasureIterInit(ctx->fs, &iter, 0, 0, string, end);
+	while (nvg__textIterNext(ctx, &iter, &q)) {
 		switch (iter.codepoint) {
 			case 9:			// \t
 			case 11:		// \v
@@ -2634,7 +3623,7 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 float nvgTextBounds(NVGcontext* ctx, float x, float y, const char* string, const char* end, float* bounds)
 {
 	NVGstate* state = nvg__getState(ctx);
-	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float scale = nvg__getFontScale(ctx, state);
 	float invscale = 1.0f / scale;
 	float width;
 
@@ -2646,7 +3635,9 @@ float nvgTextBounds(NVGcontext* ctx, float x, float y, const char* string, const
 	fonsSetAlign(ctx->fs, state->textAlign);
 	fonsSetFont(ctx->fs, state->fontId);
 
+	NVG_PROFILE_MARK(ctx);
 	width = fonsTextBounds(ctx->fs, x*scale, y*scale, string, end, bounds);
+	NVG_PROFILE_PHASE(ctx, glyphTime);
 	if (bounds != NULL) {
 		// Use line bounds for height.
 		fonsLineBounds(ctx->fs, y*scale, &bounds[1], &bounds[3]);
@@ -2662,7 +3653,7 @@ void nvgTextBoxBounds(NVGcontext* ctx, float x, float y, float breakRowWidth, co
 {
 	NVGstate* state = nvg__getState(ctx);
 	NVGtextRow rows[2];
-	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float scale = nvg__getFontScale(ctx, state);
 	float invscale = 1.0f / scale;
 	int nrows = 0, i;
 	int oldAlign = state->textAlign;
@@ -2730,7 +3721,7 @@ void nvgTextBoxBounds(NVGcontext* ctx, float x, float y, float breakRowWidth, co
 void nvgTextMetrics(NVGcontext* ctx, float* ascender, float* descender, float* lineh)
 {
 	NVGstate* state = nvg__getState(ctx);
-	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	float scale = nvg__getFontScale(ctx, state);
 	float invscale = 1.0f / scale;
 
 	if (state->fontId == FONS_INVALID) return;
@@ -31,6 +31,8 @@ extern "C" {
 #endif
 
 typedef struct NVGcontext NVGcontext;
+typedef struct NVGdisplayList NVGdisplayList;
+typedef struct NVGshape NVGshape;
 
 struct NVGcolor {
 	union {
@@ -50,6 +52,7 @@ struct NVGpaint {
 	NVGcolor innerColor;
 	NVGcolor outerColor;
 	int image;
+	float distScale;	// For triangles, the image is a distance field: alpha = (value-0.5)*distScale + 0.5.
 };
 typedef struct NVGpaint NVGpaint;
 
@@ -99,6 +102,26 @@ struct NVGtextRow {
 };
 typedef struct NVGtextRow NVGtextRow;
 
+struct NVGframeStats {
+	int drawCallCount;	// Number of draw calls the GL back-end would issue.
+	int fillTriCount;
+	int strokeTriCount;
+	int textTriCount;
+	int allocCount;		// Number of times a command, path, point or vertex buffer was grown.
+	int glyphMisses;	// Number of glyphs rasterized into the font atlas.
+	int atlasResets;	// Number of times the font atlas was full and text continued on another page.
+	int glyphEvictions;	// Number of glyphs dropped from a full font atlas to make room.
+	int kernLookups;	// Number of glyph pairs kerned.
+	int kernHits;		// Number of those found in the kerning cache.
+	// Time spent in each phase in milliseconds, only measured when nanovg.c is compiled with NVG_PROFILE.
+	double appendTime;	// Transforming and storing path commands.
+	double flattenTime;	// Tesselating commands into polylines.
+	double expandTime;	// Building fill and stroke geometry.
+	double submitTime;	// Back-end calls, including font atlas uploads and the final flush.
+	double glyphTime;	// Glyph lookup and rasterization.
+};
+typedef struct NVGframeStats NVGframeStats;
+
 enum NVGimageFlags {
     NVG_IMAGE_GENERATE_MIPMAPS	= 1<<0,     // Generate mipmaps during creation of the image.
 	NVG_IMAGE_REPEATX			= 1<<1,		// Repeat image in X direction.
@@ -123,6 +146,9 @@ void nvgCancelFrame(NVGcontext* ctx);
 // Ends drawing flushing remaining render state.
 void nvgEndFrame(NVGcontext* ctx);
 
+// Returns the statistics of the last frame ended with nvgEndFrame().
+void nvgFrameStats(NVGcontext* ctx, NVGframeStats* stats);
+
 //
 // Color utils
 //
@@ -526,7 +552,8 @@ void nvgTextBox(NVGcontext* ctx, float x, float y, float breakRowWidth, const ch
 // Measures the specified text string. Parameter bounds should be a pointer to float[4],
 // if the bounding box of the text should be returned. The bounds value are [xmin,ymin, xmax,ymax]
 // Returns the horizontal advance of the measured text (i.e. where the next character should drawn).
-// Measured values are returned in local coordinate space.
+// Measured values are returned in local coordinate space. The measuring functions below read the glyph
+// metrics from the font, they do not rasterize glyphs into the font atlas.
 float nvgTextBounds(NVGcontext* ctx, float x, float y, const char* string, const char* end, float* bounds);
 
 // Measures the specified multi-text string. Parameter bounds should be a pointer to float[4],
@@ -547,6 +574,113 @@ void nvgTextMetrics(NVGcontext* ctx, float* ascender, float* descender, float* l
 // Words longer than the max width are slit at nearest character (i.e. no hyphenation).
 int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows);
 
+// Rasterizes the glyphs of the string into the font atlas with the current font, size, blur and
+// transform scale, and uploads the atlas. Drawing the same glyphs later does not rasterize them.
+// Returns the number of glyphs added to the atlas.
+int nvgPrewarmText(NVGcontext* ctx, const char* string, const char* end);
+
+// Returns the number of pixels taken by glyphs on all font atlas pages, and the size of the current page.
+// A full atlas continues on a page no text of the frame is drawn from, or on a new one.
+int nvgFontAtlasUsage(NVGcontext* ctx, int* width, int* height);
+// Returns the number of font atlas pages, the last one is the current page.
+int nvgFontAtlasPages(NVGcontext* ctx);
+// Returns the number of pixels of a font atlas page taken by glyphs, and the page size.
+int nvgFontAtlasPageUsage(NVGcontext* ctx, int page, int* width, int* height);
+
+// Rasterizes glyphs missing from the font atlas on nthreads worker threads instead of in nvgText().
+// Text skips a glyph until it is ready, at the earliest in the next frame, and display lists recorded
+// meanwhile have to be recorded again. nvgPrewarmText() waits for its glyphs. 0 threads (the default)
+// rasterizes synchronously. Returns 0 if threads are not available.
+int nvgGlyphThreads(NVGcontext* ctx, int nthreads);
+
+// Rasterizes glyphs at pixel sizes that are powers of step (e.g. 1.25 gives 8, 10, 12.5, 15.6...)
+// and scales them down to the drawn size, so text under an animated scale reuses a few sizes instead
+// of adding glyphs nearly every frame. A larger step keeps fewer glyphs and draws them softer.
+// Measuring text uses the same sizes. Step 0 (the default) rasterizes at the exact size.
+void nvgFontSizeStep(NVGcontext* ctx, float step);
+
+// Draws text from signed distance fields, rasterized once per glyph of a font for all sizes and
+// blurs instead of once per size and blur, with the blur applied when drawing. Edges and corners
+// are a little softer than glyphs rasterized at the size. The font size step is not used meanwhile.
+void nvgFontSDF(NVGcontext* ctx, int sdf);
+
+// Serializes the font atlas pages and the glyph tables of the fonts, so that a later context with the
+// same fonts can restore them instead of rasterizing the glyphs again. The block is freed with free().
+unsigned char* nvgSaveFontCache(NVGcontext* ctx, int* size);
+
+// Restores a block from nvgSaveFontCache() into the font atlas, the fonts have to be created first.
+// Glyphs of fonts that are missing or changed are discarded. Call outside of a frame.
+// Returns the number of fonts restored, 0 if the block is invalid or stale.
+int nvgLoadFontCache(NVGcontext* ctx, const unsigned char* data, int size);
+
+//
+// Display lists
+//
+// A display list records the calls nanovg makes to the back-end together with the
+// tesselated geometry. Drawing the list skips building, flattening and expanding
+// the paths and laying out the text. The geometry is stored in screen space, so a list
+// is drawn where it was recorded; the current transform, scissor and alpha do not apply.
+
+NVGdisplayList* nvgCreateDisplayList(void);
+void nvgDeleteDisplayList(NVGdisplayList* list);
+
+// Clears the list and records the following draw calls into it, until nvgEndDisplayList().
+// The calls are rendered as usual while recording.
+void nvgBeginDisplayList(NVGcontext* ctx, NVGdisplayList* list);
+void nvgEndDisplayList(NVGcontext* ctx);
+
+// Draws the recorded calls. Returns 0 if nothing was drawn because the list is empty, or its
+// text refers to a font atlas that has been reset or had its glyphs dropped since; record the
+// list again then. The glyphs of a drawn list are kept in the atlas for the rest of the frame.
+int nvgDrawDisplayList(NVGcontext* ctx, NVGdisplayList* list);
+
+//
+// Shapes
+//
+// A shape keeps the commands of a path so it can be drawn many times. The fill and stroke
+// geometry is cached and reused while the scale and skew of the transform, the device
+// pixel ratio and the stroke width, caps and joins stay the same; moving and rotating
+// a shape only transforms the cached vertices.
+
+NVGshape* nvgCreateShape(void);
+void nvgDeleteShape(NVGshape* shape);
+
+// Starts a new path like nvgBeginPath() and records the following path commands
+// into the shape (which is cleared first), until nvgEndShape().
+// The shape is stored relative to the transform at nvgBeginShape().
+void nvgBeginShape(NVGcontext* ctx, NVGshape* shape);
+void nvgEndShape(NVGcontext* ctx);
+
+// Fills or strokes the shape with the current transform and style, like nvgFill() and nvgStroke().
+// The current path is not changed.
+void nvgFillShape(NVGcontext* ctx, NVGshape* shape);
+void nvgStrokeShape(NVGcontext* ctx, NVGshape* shape);
+
+//
+// Tracing
+//
+// When compiled with NVG_TRACE, the expensive steps report begin and end events:
+// path flattening, fill and stroke expansion, glyph rasterization, font texture
+// updates and back-end flushes. Without NVG_TRACE the probes compile to nothing.
+
+// Receives the events, time is in milliseconds from an arbitrary start.
+typedef void (*NVGtraceCallback)(void* uptr, const char* name, int begin, double time);
+
+// Sets the callback of all contexts, NULL stops tracing. Events are reported
+// on the thread that calls nanovg.
+void nvgSetTraceCallback(NVGtraceCallback callback, void* uptr);
+
+// Reports an event to the trace callback.
+void nvgTrace(const char* name, int begin);
+
+#ifdef NVG_TRACE
+#define NVG_TRACE_BEGIN(name) nvgTrace(name, 1)
+#define NVG_TRACE_END(name) nvgTrace(name, 0)
+#else
+#define NVG_TRACE_BEGIN(name)
+#define NVG_TRACE_END(name)
+#endif
+
 //
 // Internal Render API
 //
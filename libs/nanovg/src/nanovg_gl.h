@@ -85,11 +85,21 @@ void nvgDeleteGLES3(NVGcontext* ctx);
 // These are additional flags on top of NVGimageFlags.
 enum NVGimageFlagsGL {
 	NVG_IMAGE_NODELETE			= 1<<16,	// Do not delete GL texture handle.
+	NVG_IMAGE_RECTANGLE			= 1<<17,	// Texture handle is a GL_TEXTURE_RECTANGLE, sampled in pixel coordinates (desktop GL only).
 };
 
 int nvglCreateImageFromHandle(NVGcontext* ctx, GLuint textureId, int w, int h, int flags);
 GLuint nvglImageHandle(NVGcontext* ctx, int image);
 
+struct NVGglStats {
+	int vertexBytes;	// Vertex data uploaded by the flush.
+	int uniformBytes;	// Fragment uniforms uploaded by the flush (uniform buffer or glUniform calls).
+};
+typedef struct NVGglStats NVGglStats;
+
+// Returns the upload sizes of the last flushed frame (nvgEndFrame).
+void nvglFrameStats(NVGcontext* ctx, NVGglStats* stats);
+
 
 #ifdef __cplusplus
 }
@@ -105,9 +115,15 @@ GLuint nvglImageHandle(NVGcontext* ctx, int image);
 #include <math.h>
 #include "nanovg.h"
 
+// Rectangle textures are not available on OpenGL ES.
+#if defined NANOVG_GL2 || defined NANOVG_GL3
+#  define NANOVG_GL_USE_RECTANGLE 1
+#endif
+
 enum GLNVGuniformLoc {
 	GLNVG_LOC_VIEWSIZE,
 	GLNVG_LOC_TEX,
+	GLNVG_LOC_TEXRECT,
 	GLNVG_LOC_FRAG,
 	GLNVG_MAX_LOCS
 };
@@ -116,7 +132,8 @@ enum GLNVGshaderType {
 	NSVG_SHADER_FILLGRAD,
 	NSVG_SHADER_FILLIMG,
 	NSVG_SHADER_SIMPLE,
-	NSVG_SHADER_IMG
+	NSVG_SHADER_IMG,
+	NSVG_SHADER_FILLIMGRECT
 };
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
@@ -241,9 +258,13 @@ struct GLNVGcontext {
 	int cuniforms;
 	int nuniforms;
 
+	NVGglStats stats;
+	NVGglStats frameStats;
+
 	// cached state
 	#if NANOVG_GL_USE_STATE_FILTER
 	GLuint boundTexture;
+	GLuint boundRectTexture;
 	GLuint stencilMask;
 	GLenum stencilFunc;
 	GLint stencilFuncRef;
@@ -280,6 +301,21 @@ static void glnvg__bindTexture(GLNVGcontext* gl, GLuint tex)
 #endif
 }
 
+#if NANOVG_GL_USE_RECTANGLE
+// Rectangle textures live on texture unit 1, so that the 'tex' and 'texRect' samplers
+// never point to the same unit.
+static void glnvg__bindRectTexture(GLNVGcontext* gl, GLuint tex)
+{
+#if NANOVG_GL_USE_STATE_FILTER
+	if (gl->boundRectTexture == tex) return;
+	gl->boundRectTexture = tex;
+#endif
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_RECTANGLE, tex);
+	glActiveTexture(GL_TEXTURE0);
+}
+#endif
+
 static void glnvg__stencilMask(GLNVGcontext* gl, GLuint mask)
 {
 #if NANOVG_GL_USE_STATE_FILTER
@@ -458,6 +494,9 @@ static void glnvg__getUniforms(GLNVGshader* shader)
 {
 	shader->loc[GLNVG_LOC_VIEWSIZE] = glGetUniformLocation(shader->prog, "viewSize");
 	shader->loc[GLNVG_LOC_TEX] = glGetUniformLocation(shader->prog, "tex");
+#if NANOVG_GL_USE_RECTANGLE
+	shader->loc[GLNVG_LOC_TEXRECT] = glGetUniformLocation(shader->prog, "texRect");
+#endif
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
 	shader->loc[GLNVG_LOC_FRAG] = glGetUniformBlockIndex(shader->prog, "frag");
@@ -475,10 +514,13 @@ static int glnvg__renderCreate(void* uptr)
 	// see the following discussion: https://github.com/memononen/nanovg/issues/46
 	static const char* shaderHeader =
 #if defined NANOVG_GL2
+		"#extension GL_ARB_texture_rectangle : enable\n"
 		"#define NANOVG_GL2 1\n"
+		"#define USE_RECTANGLE 1\n"
 #elif defined NANOVG_GL3
 		"#version 150 core\n"
 		"#define NANOVG_GL3 1\n"
+		"#define USE_RECTANGLE 1\n"
 #elif defined NANOVG_GLES2
 		"#version 100\n"
 		"#define NANOVG_GL2 1\n"
@@ -552,6 +594,9 @@ static int glnvg__renderCreate(void* uptr)
 		"	varying vec2 ftcoord;\n"
 		"	varying vec2 fpos;\n"
 		"#endif\n"
+		"#ifdef USE_RECTANGLE\n"
+		"	uniform sampler2DRect texRect;\n"
+		"#endif\n"
 		"#ifndef USE_UNIFORMBUFFER\n"
 		"	#define scissorMat mat3(frag[0].xyz, frag[1].xyz, frag[2].xyz)\n"
 		"	#define paintMat mat3(frag[3].xyz, frag[4].xyz, frag[5].xyz)\n"
@@ -586,6 +631,16 @@ static int glnvg__renderCreate(void* uptr)
 		"	return min(1.0, (1.0-abs(ftcoord.x*2.0-1.0))*strokeMult) * min(1.0, ftcoord.y);\n"
 		"}\n"
 		"#endif\n"
+		"#ifdef USE_RECTANGLE\n"
+		"// Rectangle textures are addressed in pixels, see glnvg__convertPaint().\n"
+		"vec4 sampleRect(vec2 pt) {\n"
+		"#ifdef NANOVG_GL3\n"
+		"	return texture(texRect, pt);\n"
+		"#else\n"
+		"	return texture2DRect(texRect, pt);\n"
+		"#endif\n"
+		"}\n"
+		"#endif\n"
 		"\n"
 		"void main(void) {\n"
 		"   vec4 result;\n"
@@ -603,13 +658,17 @@ static int glnvg__renderCreate(void* uptr)
 		"		// Combine alpha\n"
 		"		color *= strokeAlpha * scissor;\n"
 		"		result = color;\n"
-		"	} else if (type == 1) {		// Image\n"
+		"	} else if (type == 1 || type == 4) {		// Image\n"
 		"		// Calculate color fron texture\n"
 		"		vec2 pt = (paintMat * vec3(fpos,1.0)).xy / extent;\n"
+		"		vec4 color;\n"
+		"#ifdef USE_RECTANGLE\n"
+		"		if (type == 4) color = sampleRect(pt); else\n"
+		"#endif\n"
 		"#ifdef NANOVG_GL3\n"
-		"		vec4 color = texture(tex, pt);\n"
+		"		color = texture(tex, pt);\n"
 		"#else\n"
-		"		vec4 color = texture2D(tex, pt);\n"
+		"		color = texture2D(tex, pt);\n"
 		"#endif\n"
 		"		if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
 		"		if (texType == 2) color = vec4(color.x);"
@@ -628,6 +687,7 @@ static int glnvg__renderCreate(void* uptr)
 		"#endif\n"
 		"		if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
 		"		if (texType == 2) color = vec4(color.x);"
+		"		if (texType == 3) color = vec4(clamp((color.x-0.5)*radius+0.5, 0.0, 1.0));\n"
 		"		color *= scissor;\n"
 		"		result = color * innerCol;\n"
 		"	}\n"
@@ -886,6 +946,22 @@ static int glnvg__convertPaint(GLNVGcontext* gl, GLNVGfragUniforms* frag, NVGpai
 	if (paint->image != 0) {
 		tex = glnvg__findTexture(gl, paint->image);
 		if (tex == NULL) return 0;
+#if NANOVG_GL_USE_RECTANGLE
+		if ((tex->flags & NVG_IMAGE_RECTANGLE) != 0) {
+			// Scale the extent so that pt/extent in the shader ends up in texels.
+			frag->extent[0] = paint->extent[0] / (float)tex->width;
+			frag->extent[1] = paint->extent[1] / (float)tex->height;
+		}
+		if ((tex->flags & (NVG_IMAGE_FLIPY | NVG_IMAGE_RECTANGLE)) == (NVG_IMAGE_FLIPY | NVG_IMAGE_RECTANGLE)) {
+			// Rectangle textures cannot wrap, flip within the pattern instead.
+			float flipped[6], offset[6];
+			nvgTransformScale(flipped, 1.0f, -1.0f);
+			nvgTransformTranslate(offset, 0.0f, paint->extent[1]);
+			nvgTransformMultiply(flipped, offset);
+			nvgTransformMultiply(flipped, paint->xform);
+			nvgTransformInverse(invxform, flipped);
+		} else
+#endif
 		if ((tex->flags & NVG_IMAGE_FLIPY) != 0) {
 			float flipped[6];
 			nvgTransformScale(flipped, 1.0f, -1.0f);
@@ -895,6 +971,10 @@ static int glnvg__convertPaint(GLNVGcontext* gl, GLNVGfragUniforms* frag, NVGpai
 			nvgTransformInverse(invxform, paint->xform);
 		}
 		frag->type = NSVG_SHADER_FILLIMG;
+#if NANOVG_GL_USE_RECTANGLE
+		if ((tex->flags & NVG_IMAGE_RECTANGLE) != 0)
+			frag->type = NSVG_SHADER_FILLIMGRECT;
+#endif
 
 		if (tex->type == NVG_TEXTURE_RGBA)
 			frag->texType = (tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0 : 1;
@@ -922,10 +1002,18 @@ static void glnvg__setUniforms(GLNVGcontext* gl, int uniformOffset, int image)
 #else
 	GLNVGfragUniforms* frag = nvg__fragUniformPtr(gl, uniformOffset);
 	glUniform4fv(gl->shader.loc[GLNVG_LOC_FRAG], NANOVG_GL_UNIFORMARRAY_SIZE, &(frag->uniformArray[0][0]));
+	gl->stats.uniformBytes += sizeof(frag->uniformArray);
 #endif
 
 	if (image != 0) {
 		GLNVGtexture* tex = glnvg__findTexture(gl, image);
+#if NANOVG_GL_USE_RECTANGLE
+		if (tex != NULL && (tex->flags & NVG_IMAGE_RECTANGLE) != 0) {
+			glnvg__bindRectTexture(gl, tex->tex);
+			glnvg__checkError(gl, "tex paint rect tex");
+			return;
+		}
+#endif
 		glnvg__bindTexture(gl, tex != NULL ? tex->tex : 0);
 		glnvg__checkError(gl, "tex paint tex");
 	} else {
@@ -1069,6 +1157,8 @@ static void glnvg__renderFlush(void* uptr)
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
 	int i;
 
+	NVG_TRACE_BEGIN("glnvg__renderFlush");
+
 	if (gl->ncalls > 0) {
 
 		// Setup require GL state.
@@ -1087,8 +1177,14 @@ static void glnvg__renderFlush(void* uptr)
 		glStencilFunc(GL_ALWAYS, 0, 0xffffffff);
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, 0);
+		#if NANOVG_GL_USE_RECTANGLE
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_RECTANGLE, 0);
+		glActiveTexture(GL_TEXTURE0);
+		#endif
 		#if NANOVG_GL_USE_STATE_FILTER
 		gl->boundTexture = 0;
+		gl->boundRectTexture = 0;
 		gl->stencilMask = 0xffffffff;
 		gl->stencilFunc = GL_ALWAYS;
 		gl->stencilFuncRef = 0;
@@ -1099,6 +1195,7 @@ static void glnvg__renderFlush(void* uptr)
 		// Upload ubo for frag shaders
 		glBindBuffer(GL_UNIFORM_BUFFER, gl->fragBuf);
 		glBufferData(GL_UNIFORM_BUFFER, gl->nuniforms * gl->fragSize, gl->uniforms, GL_STREAM_DRAW);
+		gl->stats.uniformBytes += gl->nuniforms * gl->fragSize;
 #endif
 
 		// Upload vertex data
@@ -1107,6 +1204,7 @@ static void glnvg__renderFlush(void* uptr)
 #endif
 		glBindBuffer(GL_ARRAY_BUFFER, gl->vertBuf);
 		glBufferData(GL_ARRAY_BUFFER, gl->nverts * sizeof(NVGvertex), gl->verts, GL_STREAM_DRAW);
+		gl->stats.vertexBytes += gl->nverts * sizeof(NVGvertex);
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
 		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(size_t)0);
@@ -1114,6 +1212,9 @@ static void glnvg__renderFlush(void* uptr)
 
 		// Set view and texture just once per frame.
 		glUniform1i(gl->shader.loc[GLNVG_LOC_TEX], 0);
+#if NANOVG_GL_USE_RECTANGLE
+		glUniform1i(gl->shader.loc[GLNVG_LOC_TEXRECT], 1);
+#endif
 		glUniform2fv(gl->shader.loc[GLNVG_LOC_VIEWSIZE], 1, gl->view);
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
@@ -1141,6 +1242,9 @@ static void glnvg__renderFlush(void* uptr)
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glUseProgram(0);
 		glnvg__bindTexture(gl, 0);
+#if NANOVG_GL_USE_RECTANGLE
+		glnvg__bindRectTexture(gl, 0);
+#endif
 	}
 
 	// Reset calls
@@ -1148,6 +1252,11 @@ static void glnvg__renderFlush(void* uptr)
 	gl->npaths = 0;
 	gl->ncalls = 0;
 	gl->nuniforms = 0;
+
+	gl->frameStats = gl->stats;
+	memset(&gl->stats, 0, sizeof(gl->stats));
+
+	NVG_TRACE_END("glnvg__renderFlush");
 }
 
 static int glnvg__maxVertCount(const NVGpath* paths, int npaths)
@@ -1398,6 +1507,11 @@ static void glnvg__renderTriangles(void* uptr, NVGpaint* paint, NVGscissor* scis
 	frag = nvg__fragUniformPtr(gl, call->uniformOffset);
 	glnvg__convertPaint(gl, frag, paint, scissor, 1.0f, 1.0f, -1.0f);
 	frag->type = NSVG_SHADER_IMG;
+	if (paint->distScale > 0.0f) {
+		// Distance field text, the scale goes in the unused radius.
+		frag->texType = 3;
+		frag->radius = paint->distScale;
+	}
 
 	return;
 
@@ -1522,4 +1636,10 @@ GLuint nvglImageHandle(NVGcontext* ctx, int image)
 	return tex->tex;
 }
 
+void nvglFrameStats(NVGcontext* ctx, NVGglStats* stats)
+{
+	GLNVGcontext* gl = (GLNVGcontext*)nvgInternalParams(ctx)->userPtr;
+	*stats = gl->frameStats;
+}
+
 #endif /* NANOVG_GL_IMPLEMENTATION */
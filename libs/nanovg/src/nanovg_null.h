@@ -0,0 +1,348 @@
+//
+// Copyright (c) 2009-2013 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+#ifndef NANOVG_NULL_H
+#define NANOVG_NULL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Null back-end. It accepts all geometry and only counts it, which makes it
+// possible to measure the CPU side of nanovg (path flattening, stroke and fill
+// expansion, glyph layout and atlas updates) without any GPU in the loop.
+
+// Create flags
+
+enum NVGnullCreateFlags {
+	// Flag indicating if geometry based anti-aliasing is used, affects the amount of geometry generated.
+	NVGNULL_ANTIALIAS	= 1<<0,
+	// Flag indicating that the geometry is copied into per frame buffers like the GL back-end does,
+	// so that the copy is part of the measurement.
+	NVGNULL_RECORD		= 1<<1,
+};
+
+struct NVGnullStats {
+	int fillCalls;
+	int strokeCalls;
+	int triangleCalls;
+	int paths;
+	int fillVerts;
+	int strokeVerts;
+	int triangleVerts;
+	int textureUploads;		// renderCreateTexture and renderUpdateTexture calls
+	int textureUploadBytes;
+};
+typedef struct NVGnullStats NVGnullStats;
+
+NVGcontext* nvgCreateNull(int flags);
+void nvgDeleteNull(NVGcontext* ctx);
+
+// Returns the counters of the last flushed frame (nvgEndFrame). Texture uploads made
+// between frames are counted towards the next frame.
+void nvgnullFrameStats(NVGcontext* ctx, NVGnullStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NANOVG_NULL_H */
+
+#ifdef NANOVG_NULL_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <string.h>
+#include "nanovg.h"
+
+struct NULLNVGtexture {
+	int id;
+	int width, height;
+	int type;
+	int flags;
+};
+typedef struct NULLNVGtexture NULLNVGtexture;
+
+struct NULLNVGcontext {
+	NULLNVGtexture* textures;
+	int ntextures;
+	int ctextures;
+	int textureId;
+	int flags;
+
+	NVGnullStats stats;
+	NVGnullStats frameStats;
+
+	// Per frame buffer, used with NVGNULL_RECORD
+	struct NVGvertex* verts;
+	int cverts;
+	int nverts;
+};
+typedef struct NULLNVGcontext NULLNVGcontext;
+
+static int nullnvg__maxi(int a, int b) { return a > b ? a : b; }
+
+static NULLNVGtexture* nullnvg__allocTexture(NULLNVGcontext* nl)
+{
+	NULLNVGtexture* tex = NULL;
+	int i;
+
+	for (i = 0; i < nl->ntextures; i++) {
+		if (nl->textures[i].id == 0) {
+			tex = &nl->textures[i];
+			break;
+		}
+	}
+	if (tex == NULL) {
+		if (nl->ntextures+1 > nl->ctextures) {
+			NULLNVGtexture* textures;
+			int ctextures = nullnvg__maxi(nl->ntextures+1, 4) +  nl->ctextures/2; // 1.5x Overallocate
+			textures = (NULLNVGtexture*)realloc(nl->textures, sizeof(NULLNVGtexture)*ctextures);
+			if (textures == NULL) return NULL;
+			nl->textures = textures;
+			nl->ctextures = ctextures;
+		}
+		tex = &nl->textures[nl->ntextures++];
+	}
+
+	memset(tex, 0, sizeof(*tex));
+	tex->id = ++nl->textureId;
+
+	return tex;
+}
+
+static NULLNVGtexture* nullnvg__findTexture(NULLNVGcontext* nl, int id)
+{
+	int i;
+	for (i = 0; i < nl->ntextures; i++)
+		if (nl->textures[i].id == id)
+			return &nl->textures[i];
+	return NULL;
+}
+
+static int nullnvg__renderCreate(void* uptr)
+{
+	NVG_NOTUSED(uptr);
+	return 1;
+}
+
+static int nullnvg__renderCreateTexture(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)uptr;
+	NULLNVGtexture* tex = nullnvg__allocTexture(nl);
+
+	if (tex == NULL) return 0;
+
+	tex->width = w;
+	tex->height = h;
+	tex->type = type;
+	tex->flags = imageFlags;
+
+	if (data != NULL) {
+		nl->stats.textureUploads++;
+		nl->stats.textureUploadBytes += w * h * (type == NVG_TEXTURE_RGBA ? 4 : 1);
+	}
+
+	return tex->id;
+}
+
+static int nullnvg__renderDeleteTexture(void* uptr, int image)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)uptr;
+	NULLNVGtexture* tex = nullnvg__findTexture(nl, image);
+	if (tex == NULL) return 0;
+	memset(tex, 0, sizeof(*tex));
+	return 1;
+}
+
+static int nullnvg__renderUpdateTexture(void* uptr, int image, int x, int y, int w, int h, const unsigned char* data)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)uptr;
+	NULLNVGtexture* tex = nullnvg__findTexture(nl, image);
+	NVG_NOTUSED(x);
+	NVG_NOTUSED(y);
+	NVG_NOTUSED(data);
+
+	if (tex == NULL) return 0;
+
+	nl->stats.textureUploads++;
+	nl->stats.textureUploadBytes += w * h * (tex->type == NVG_TEXTURE_RGBA ? 4 : 1);
+
+	return 1;
+}
+
+static int nullnvg__renderGetTextureSize(void* uptr, int image, int* w, int* h)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)uptr;
+	NULLNVGtexture* tex = nullnvg__findTexture(nl, image);
+	if (tex == NULL) return 0;
+	*w = tex->width;
+	*h = tex->height;
+	return 1;
+}
+
+static void nullnvg__renderViewport(void* uptr, int width, int height)
+{
+	NVG_NOTUSED(uptr);
+	NVG_NOTUSED(width);
+	NVG_NOTUSED(height);
+}
+
+static void nullnvg__renderCancel(void* uptr)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)uptr;
+	int uploads = nl->stats.textureUploads, uploadBytes = nl->stats.textureUploadBytes;
+	// Drop the geometry of the cancelled frame, texture uploads did happen.
+	memset(&nl->stats, 0, sizeof(nl->stats));
+	nl->stats.textureUploads = uploads;
+	nl->stats.textureUploadBytes = uploadBytes;
+	nl->nverts = 0;
+}
+
+static void nullnvg__renderFlush(void* uptr)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)uptr;
+	nl->frameStats = nl->stats;
+	memset(&nl->stats, 0, sizeof(nl->stats));
+	nl->nverts = 0;
+}
+
+static void nullnvg__record(NULLNVGcontext* nl, const NVGvertex* verts, int n)
+{
+	if (n <= 0 || (nl->flags & NVGNULL_RECORD) == 0) return;
+
+	if (nl->nverts+n > nl->cverts) {
+		NVGvertex* buf;
+		int cverts = nullnvg__maxi(nl->nverts + n, 4096) + nl->cverts/2; // 1.5x Overallocate
+		buf = (NVGvertex*)realloc(nl->verts, sizeof(NVGvertex) * cverts);
+		if (buf == NULL) return;
+		nl->verts = buf;
+		nl->cverts = cverts;
+	}
+	memcpy(&nl->verts[nl->nverts], verts, sizeof(NVGvertex) * n);
+	nl->nverts += n;
+}
+
+static void nullnvg__renderFill(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe,
+								const float* bounds, const NVGpath* paths, int npaths)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)uptr;
+	int i;
+	NVG_NOTUSED(paint);
+	NVG_NOTUSED(scissor);
+	NVG_NOTUSED(fringe);
+	NVG_NOTUSED(bounds);
+
+	nl->stats.fillCalls++;
+	nl->stats.paths += npaths;
+	for (i = 0; i < npaths; i++) {
+		nl->stats.fillVerts += paths[i].nfill;
+		nl->stats.strokeVerts += paths[i].nstroke;
+		nullnvg__record(nl, paths[i].fill, paths[i].nfill);
+		nullnvg__record(nl, paths[i].stroke, paths[i].nstroke);
+	}
+}
+
+static void nullnvg__renderStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe,
+								  float strokeWidth, const NVGpath* paths, int npaths)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)uptr;
+	int i;
+	NVG_NOTUSED(paint);
+	NVG_NOTUSED(scissor);
+	NVG_NOTUSED(fringe);
+	NVG_NOTUSED(strokeWidth);
+
+	nl->stats.strokeCalls++;
+	nl->stats.paths += npaths;
+	for (i = 0; i < npaths; i++) {
+		nl->stats.strokeVerts += paths[i].nstroke;
+		nullnvg__record(nl, paths[i].stroke, paths[i].nstroke);
+	}
+}
+
+static void nullnvg__renderTriangles(void* uptr, NVGpaint* paint, NVGscissor* scissor,
+									 const NVGvertex* verts, int nverts)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)uptr;
+	NVG_NOTUSED(paint);
+	NVG_NOTUSED(scissor);
+
+	nl->stats.triangleCalls++;
+	nl->stats.triangleVerts += nverts;
+	nullnvg__record(nl, verts, nverts);
+}
+
+static void nullnvg__renderDelete(void* uptr)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)uptr;
+	if (nl == NULL) return;
+
+	free(nl->textures);
+	free(nl->verts);
+	free(nl);
+}
+
+
+NVGcontext* nvgCreateNull(int flags)
+{
+	NVGparams params;
+	NVGcontext* ctx = NULL;
+	NULLNVGcontext* nl = (NULLNVGcontext*)malloc(sizeof(NULLNVGcontext));
+	if (nl == NULL) goto error;
+	memset(nl, 0, sizeof(NULLNVGcontext));
+
+	memset(&params, 0, sizeof(params));
+	params.renderCreate = nullnvg__renderCreate;
+	params.renderCreateTexture = nullnvg__renderCreateTexture;
+	params.renderDeleteTexture = nullnvg__renderDeleteTexture;
+	params.renderUpdateTexture = nullnvg__renderUpdateTexture;
+	params.renderGetTextureSize = nullnvg__renderGetTextureSize;
+	params.renderViewport = nullnvg__renderViewport;
+	params.renderCancel = nullnvg__renderCancel;
+	params.renderFlush = nullnvg__renderFlush;
+	params.renderFill = nullnvg__renderFill;
+	params.renderStroke = nullnvg__renderStroke;
+	params.renderTriangles = nullnvg__renderTriangles;
+	params.renderDelete = nullnvg__renderDelete;
+	params.userPtr = nl;
+	params.edgeAntiAlias = flags & NVGNULL_ANTIALIAS ? 1 : 0;
+
+	nl->flags = flags;
+
+	ctx = nvgCreateInternal(&params);
+	if (ctx == NULL) goto error;
+
+	return ctx;
+
+error:
+	// 'nl' is freed by nvgDeleteInternal.
+	if (ctx != NULL) nvgDeleteInternal(ctx);
+	return NULL;
+}
+
+void nvgDeleteNull(NVGcontext* ctx)
+{
+	nvgDeleteInternal(ctx);
+}
+
+void nvgnullFrameStats(NVGcontext* ctx, NVGnullStats* stats)
+{
+	NULLNVGcontext* nl = (NULLNVGcontext*)nvgInternalParams(ctx)->userPtr;
+	*stats = nl->frameStats;
+}
+
+#endif /* NANOVG_NULL_IMPLEMENTATION */
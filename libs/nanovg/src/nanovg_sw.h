@@ -0,0 +1,1522 @@
+//
+// Copyright (c) 2009-2013 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+#ifndef NANOVG_SW_H
+#define NANOVG_SW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Software (CPU only) back-end. It follows the GL back-end call for call: draw
+// calls are recorded during the frame and rasterized on flush, the stencil
+// buffer and face culling are emulated, and the fragment shader is evaluated
+// per pixel, so the output matches the GL renderer without needing a GL context.
+
+// Create flags
+
+enum NVGswCreateFlags {
+	// Flag indicating if geometry based anti-aliasing is used.
+	NVGSW_ANTIALIAS 		= 1<<0,
+	// Flag indicating if strokes should be drawn using the (emulated) stencil buffer.
+	// Path overlaps (i.e. self-intersecting or sharp turns) will be drawn just once.
+	NVGSW_STENCIL_STROKES	= 1<<1,
+};
+
+// Creates NanoVG context which renders into a caller supplied RGBA buffer.
+// Flags should be combination of the create flags above.
+NVGcontext* nvgCreateSW(int flags);
+void nvgDeleteSW(NVGcontext* ctx);
+
+// Sets the render target. Pixels are 8-bit RGBA with premultiplied alpha, first row at the top,
+// stride is the size of a row in bytes. The buffer stays owned by the caller.
+void nvgswSetFramebuffer(NVGcontext* ctx, unsigned char* pixels, int w, int h, int stride);
+
+// Clears the render target (and the stencil buffer) to given color.
+void nvgswClear(NVGcontext* ctx, NVGcolor color);
+
+// Sets the number of threads used to rasterize a frame, including the calling thread.
+// With more than one thread the draw calls of the frame are binned into screen tiles
+// which are rasterized in parallel. Every tile replays its calls in submission order and
+// attributes are evaluated per pixel, so the output is identical to the single threaded renderer.
+void nvgswSetThreads(NVGcontext* ctx, int nthreads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NANOVG_SW_H */
+
+#ifdef NANOVG_SW_IMPLEMENTATION
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "nanovg.h"
+
+#ifndef NANOVG_SW_NO_THREADS
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
+
+// Vertices are snapped to 1/256th of a pixel before rasterization, the same
+// kind of precision GPUs use, which keeps the edge equations exact.
+#define SWNVG_SUBPIXEL_BITS 8
+#define SWNVG_SUBPIXEL (1 << SWNVG_SUBPIXEL_BITS)
+#define SWNVG_MAX_COORD 1.0e6f
+
+#define SWNVG_TILE_SIZE 64
+
+enum SWNVGshaderType {
+	SWNVG_SHADER_FILLGRAD,
+	SWNVG_SHADER_FILLIMG,
+	SWNVG_SHADER_SIMPLE,
+	SWNVG_SHADER_IMG
+};
+
+enum SWNVGprimitive {
+	SWNVG_TRIANGLES,
+	SWNVG_TRIANGLE_STRIP,
+	SWNVG_TRIANGLE_FAN,
+};
+
+enum SWNVGstencilFunc {
+	SWNVG_STENCIL_ALWAYS,
+	SWNVG_STENCIL_EQUAL0,
+	SWNVG_STENCIL_NOTEQUAL0,
+};
+
+enum SWNVGstencilOp {
+	SWNVG_STENCIL_KEEP,
+	SWNVG_STENCIL_ZERO,
+	SWNVG_STENCIL_INCR,
+	SWNVG_STENCIL_INCR_DECR_WRAP,	// Increment front faces, decrement back faces.
+};
+
+struct SWNVGtexture {
+	int id;
+	unsigned char* data;
+	int width, height;
+	int type;
+	int flags;
+};
+typedef struct SWNVGtexture SWNVGtexture;
+
+enum SWNVGcallType {
+	SWNVG_NONE = 0,
+	SWNVG_FILL,
+	SWNVG_CONVEXFILL,
+	SWNVG_STROKE,
+	SWNVG_TRIANGLES_CALL,
+};
+
+struct SWNVGcall {
+	int type;
+	int image;
+	int pathOffset;
+	int pathCount;
+	int triangleOffset;
+	int triangleCount;
+	int uniformOffset;
+	float bounds[4];
+};
+typedef struct SWNVGcall SWNVGcall;
+
+struct SWNVGpath {
+	int fillOffset;
+	int fillCount;
+	int strokeOffset;
+	int strokeCount;
+};
+typedef struct SWNVGpath SWNVGpath;
+
+// Same values as the GL fragment uniforms, but the matrices are kept in
+// nanovg's 2x3 layout.
+struct SWNVGfragUniforms {
+	float scissorMat[6];
+	float paintMat[6];
+	NVGcolor innerCol;
+	NVGcolor outerCol;
+	float scissorExt[2];
+	float scissorScale[2];
+	float extent[2];
+	float radius;
+	float feather;
+	float strokeMult;
+	float strokeThr;
+	int texType;
+	int type;
+};
+typedef struct SWNVGfragUniforms SWNVGfragUniforms;
+
+// Fixed function state for one draw, the software version of the GL state
+// the GL back-end sets up before glDrawArrays().
+struct SWNVGstate {
+	int cull;
+	int colorMask;
+	int stencilFunc;
+	int stencilOp;
+	const SWNVGfragUniforms* frag;
+	const SWNVGtexture* tex;
+};
+typedef struct SWNVGstate SWNVGstate;
+
+#ifndef NANOVG_SW_NO_THREADS
+#ifdef _WIN32
+typedef CRITICAL_SECTION SWNVGmutex;
+typedef CONDITION_VARIABLE SWNVGcond;
+typedef HANDLE SWNVGthread;
+#else
+typedef pthread_mutex_t SWNVGmutex;
+typedef pthread_cond_t SWNVGcond;
+typedef pthread_t SWNVGthread;
+#endif
+
+// Persistent worker threads. The thread calling nvgEndFrame() works on the
+// tiles too, so there are nthreads-1 workers.
+struct SWNVGworkers {
+	SWNVGthread* threads;
+	int nthreads;
+	SWNVGmutex lock;
+	SWNVGcond start;
+	SWNVGcond done;
+	int generation;
+	int busy;
+	int nextTile;
+	int quit;
+	struct SWNVGcontext* sw;
+};
+typedef struct SWNVGworkers SWNVGworkers;
+#endif
+
+struct SWNVGcontext {
+	SWNVGtexture* textures;
+	float view[2];
+	int ntextures;
+	int ctextures;
+	int textureId;
+	int flags;
+
+	// Render target
+	unsigned char* pixels;
+	int width, height, stride;
+	unsigned char* stencil;
+	int cstencil;
+
+	// Per frame buffers
+	SWNVGcall* calls;
+	int ccalls;
+	int ncalls;
+	SWNVGpath* paths;
+	int cpaths;
+	int npaths;
+	struct NVGvertex* verts;
+	int cverts;
+	int nverts;
+	SWNVGfragUniforms* uniforms;
+	int cuniforms;
+	int nuniforms;
+
+	// Tile bins, calls overlapping tile i are tileCalls[tileOffsets[i]..tileOffsets[i+1]).
+	int* tileOffsets;
+	int ctileOffsets;
+	int* tileCalls;
+	int ctileCalls;
+	int ntilesx, ntilesy;
+
+#ifndef NANOVG_SW_NO_THREADS
+	SWNVGworkers* workers;
+#endif
+};
+typedef struct SWNVGcontext SWNVGcontext;
+
+static int swnvg__maxi(int a, int b) { return a > b ? a : b; }
+static int swnvg__mini(int a, int b) { return a < b ? a : b; }
+static float swnvg__minf(float a, float b) { return a < b ? a : b; }
+static float swnvg__maxf(float a, float b) { return a > b ? a : b; }
+static float swnvg__clampf(float a, float mn, float mx) { return a < mn ? mn : (a > mx ? mx : a); }
+
+static long long swnvg__floorDiv(long long a, long long b)
+{
+	// b > 0
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static SWNVGtexture* swnvg__allocTexture(SWNVGcontext* sw)
+{
+	SWNVGtexture* tex = NULL;
+	int i;
+
+	for (i = 0; i < sw->ntextures; i++) {
+		if (sw->textures[i].id == 0) {
+			tex = &sw->textures[i];
+			break;
+		}
+	}
+	if (tex == NULL) {
+		if (sw->ntextures+1 > sw->ctextures) {
+			SWNVGtexture* textures;
+			int ctextures = swnvg__maxi(sw->ntextures+1, 4) +  sw->ctextures/2; // 1.5x Overallocate
+			textures = (SWNVGtexture*)realloc(sw->textures, sizeof(SWNVGtexture)*ctextures);
+			if (textures == NULL) return NULL;
+			sw->textures = textures;
+			sw->ctextures = ctextures;
+		}
+		tex = &sw->textures[sw->ntextures++];
+	}
+
+	memset(tex, 0, sizeof(*tex));
+	tex->id = ++sw->textureId;
+
+	return tex;
+}
+
+static SWNVGtexture* swnvg__findTexture(SWNVGcontext* sw, int id)
+{
+	int i;
+	for (i = 0; i < sw->ntextures; i++)
+		if (sw->textures[i].id == id)
+			return &sw->textures[i];
+	return NULL;
+}
+
+static int swnvg__deleteTexture(SWNVGcontext* sw, int id)
+{
+	int i;
+	for (i = 0; i < sw->ntextures; i++) {
+		if (sw->textures[i].id == id) {
+			free(sw->textures[i].data);
+			memset(&sw->textures[i], 0, sizeof(sw->textures[i]));
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int swnvg__renderCreate(void* uptr)
+{
+	NVG_NOTUSED(uptr);
+	return 1;
+}
+
+static int swnvg__renderCreateTexture(void* uptr, int type, int w, int h, int imageFlags, const unsigned char* data)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	SWNVGtexture* tex = swnvg__allocTexture(sw);
+	int bpp = type == NVG_TEXTURE_RGBA ? 4 : 1;
+
+	if (tex == NULL) return 0;
+
+	// Mipmaps are not generated, the base level is always sampled.
+	tex->data = (unsigned char*)malloc(w * h * bpp);
+	if (tex->data == NULL) {
+		memset(tex, 0, sizeof(*tex));
+		return 0;
+	}
+	if (data != NULL)
+		memcpy(tex->data, data, w * h * bpp);
+	else
+		memset(tex->data, 0, w * h * bpp);
+
+	tex->width = w;
+	tex->height = h;
+	tex->type = type;
+	tex->flags = imageFlags;
+
+	return tex->id;
+}
+
+static int swnvg__renderDeleteTexture(void* uptr, int image)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	return swnvg__deleteTexture(sw, image);
+}
+
+static int swnvg__renderUpdateTexture(void* uptr, int image, int x, int y, int w, int h, const unsigned char* data)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	SWNVGtexture* tex = swnvg__findTexture(sw, image);
+	int bpp, row;
+
+	if (tex == NULL) return 0;
+
+	// Like the GL back-end, data points to the whole image and only the
+	// region x,y,w,h is copied.
+	bpp = tex->type == NVG_TEXTURE_RGBA ? 4 : 1;
+	for (row = y; row < y + h; row++) {
+		int offset = (row * tex->width + x) * bpp;
+		memcpy(&tex->data[offset], &data[offset], w * bpp);
+	}
+
+	return 1;
+}
+
+static int swnvg__renderGetTextureSize(void* uptr, int image, int* w, int* h)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	SWNVGtexture* tex = swnvg__findTexture(sw, image);
+	if (tex == NULL) return 0;
+	*w = tex->width;
+	*h = tex->height;
+	return 1;
+}
+
+static NVGcolor swnvg__premulColor(NVGcolor c)
+{
+	c.r *= c.a;
+	c.g *= c.a;
+	c.b *= c.a;
+	return c;
+}
+
+static int swnvg__convertPaint(SWNVGcontext* sw, SWNVGfragUniforms* frag, NVGpaint* paint,
+							   NVGscissor* scissor, float width, float fringe, float strokeThr)
+{
+	SWNVGtexture* tex = NULL;
+
+	memset(frag, 0, sizeof(*frag));
+
+	frag->innerCol = swnvg__premulColor(paint->innerColor);
+	frag->outerCol = swnvg__premulColor(paint->outerColor);
+
+	if (scissor->extent[0] < -0.5f || scissor->extent[1] < -0.5f) {
+		memset(frag->scissorMat, 0, sizeof(frag->scissorMat));
+		frag->scissorExt[0] = 1.0f;
+		frag->scissorExt[1] = 1.0f;
+		frag->scissorScale[0] = 1.0f;
+		frag->scissorScale[1] = 1.0f;
+	} else {
+		nvgTransformInverse(frag->scissorMat, scissor->xform);
+		frag->scissorExt[0] = scissor->extent[0];
+		frag->scissorExt[1] = scissor->extent[1];
+		frag->scissorScale[0] = sqrtf(scissor->xform[0]*scissor->xform[0] + scissor->xform[2]*scissor->xform[2]) / fringe;
+		frag->scissorScale[1] = sqrtf(scissor->xform[1]*scissor->xform[1] + scissor->xform[3]*scissor->xform[3]) / fringe;
+	}
+
+	memcpy(frag->extent, paint->extent, sizeof(frag->extent));
+	frag->strokeMult = (width*0.5f + fringe*0.5f) / fringe;
+	frag->strokeThr = strokeThr;
+
+	if (paint->image != 0) {
+		tex = swnvg__findTexture(sw, paint->image);
+		if (tex == NULL) return 0;
+		if ((tex->flags & NVG_IMAGE_FLIPY) != 0) {
+			float flipped[6];
+			nvgTransformScale(flipped, 1.0f, -1.0f);
+			nvgTransformMultiply(flipped, paint->xform);
+			nvgTransformInverse(frag->paintMat, flipped);
+		} else {
+			nvgTransformInverse(frag->paintMat, paint->xform);
+		}
+		frag->type = SWNVG_SHADER_FILLIMG;
+
+		if (tex->type == NVG_TEXTURE_RGBA)
+			frag->texType = (tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0 : 1;
+		else
+			frag->texType = 2;
+	} else {
+		frag->type = SWNVG_SHADER_FILLGRAD;
+		frag->radius = paint->radius;
+		frag->feather = paint->feather;
+		nvgTransformInverse(frag->paintMat, paint->xform);
+	}
+
+	return 1;
+}
+
+static void swnvg__renderViewport(void* uptr, int width, int height)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	sw->view[0] = (float)width;
+	sw->view[1] = (float)height;
+}
+
+//
+// Fragment shading, a straight port of the GL fragment shader.
+//
+
+static float swnvg__sdroundrect(float ptx, float pty, float extx, float exty, float rad)
+{
+	float ext2x = extx - rad, ext2y = exty - rad;
+	float dx = fabsf(ptx) - ext2x, dy = fabsf(pty) - ext2y;
+	float mx = swnvg__maxf(dx, 0.0f), my = swnvg__maxf(dy, 0.0f);
+	return swnvg__minf(swnvg__maxf(dx, dy), 0.0f) + sqrtf(mx*mx + my*my) - rad;
+}
+
+static float swnvg__scissorMask(const SWNVGfragUniforms* frag, float px, float py)
+{
+	const float* m = frag->scissorMat;
+	float scx = fabsf(m[0]*px + m[2]*py + m[4]) - frag->scissorExt[0];
+	float scy = fabsf(m[1]*px + m[3]*py + m[5]) - frag->scissorExt[1];
+	scx = 0.5f - scx * frag->scissorScale[0];
+	scy = 0.5f - scy * frag->scissorScale[1];
+	return swnvg__clampf(scx, 0.0f, 1.0f) * swnvg__clampf(scy, 0.0f, 1.0f);
+}
+
+static int swnvg__wrap(int i, int n, int repeat)
+{
+	if (repeat) {
+		i %= n;
+		return i < 0 ? i + n : i;
+	}
+	return i < 0 ? 0 : (i >= n ? n-1 : i);
+}
+
+static void swnvg__fetch(const SWNVGtexture* tex, int x, int y, float* c)
+{
+	if (tex->type == NVG_TEXTURE_RGBA) {
+		const unsigned char* p = &tex->data[(y * tex->width + x) * 4];
+		c[0] = p[0] * (1.0f/255.0f);
+		c[1] = p[1] * (1.0f/255.0f);
+		c[2] = p[2] * (1.0f/255.0f);
+		c[3] = p[3] * (1.0f/255.0f);
+	} else {
+		// Single channel textures read as (r,0,0,1) like GL_RED.
+		c[0] = tex->data[y * tex->width + x] * (1.0f/255.0f);
+		c[1] = 0.0f;
+		c[2] = 0.0f;
+		c[3] = 1.0f;
+	}
+}
+
+// Bilinear sampling with GL_LINEAR semantics.
+static void swnvg__sampleTexture(const SWNVGtexture* tex, float s, float t, float* color)
+{
+	float fx = s * tex->width - 0.5f, fy = t * tex->height - 0.5f;
+	float x0f = floorf(fx), y0f = floorf(fy);
+	float ax = fx - x0f, ay = fy - y0f;
+	int repx = (tex->flags & NVG_IMAGE_REPEATX) != 0;
+	int repy = (tex->flags & NVG_IMAGE_REPEATY) != 0;
+	int x0 = swnvg__wrap((int)x0f, tex->width, repx), x1 = swnvg__wrap((int)x0f + 1, tex->width, repx);
+	int y0 = swnvg__wrap((int)y0f, tex->height, repy), y1 = swnvg__wrap((int)y0f + 1, tex->height, repy);
+	float c00[4], c10[4], c01[4], c11[4];
+	int i;
+
+	if (ax == 0.0f && ay == 0.0f) {
+		swnvg__fetch(tex, x0, y0, color);
+		return;
+	}
+
+	swnvg__fetch(tex, x0, y0, c00);
+	swnvg__fetch(tex, x1, y0, c10);
+	swnvg__fetch(tex, x0, y1, c01);
+	swnvg__fetch(tex, x1, y1, c11);
+	for (i = 0; i < 4; i++) {
+		float top = c00[i] + (c10[i] - c00[i]) * ax;
+		float bottom = c01[i] + (c11[i] - c01[i]) * ax;
+		color[i] = top + (bottom - top) * ay;
+	}
+}
+
+static void swnvg__texColor(const SWNVGfragUniforms* frag, const SWNVGtexture* tex, float s, float t, float* color)
+{
+	if (tex == NULL) {
+		color[0] = color[1] = color[2] = color[3] = 0.0f;
+		return;
+	}
+	swnvg__sampleTexture(tex, s, t, color);
+	if (frag->texType == 1) {
+		color[0] *= color[3];
+		color[1] *= color[3];
+		color[2] *= color[3];
+	} else if (frag->texType == 2) {
+		color[1] = color[2] = color[3] = color[0];
+	} else if (frag->texType == 3) {
+		color[0] = swnvg__clampf((color[0] - 0.5f) * frag->radius + 0.5f, 0.0f, 1.0f);
+		color[1] = color[2] = color[3] = color[0];
+	}
+}
+
+// Computes premultiplied color of a fragment, returns 0 if the fragment is discarded.
+static int swnvg__shade(const SWNVGcontext* sw, const SWNVGstate* st, float px, float py, float u, float v, float* result)
+{
+	const SWNVGfragUniforms* frag = st->frag;
+	float scissor = swnvg__scissorMask(frag, px, py);
+	float strokeAlpha = 1.0f;
+	float a;
+	int i;
+
+	if (sw->flags & NVGSW_ANTIALIAS)
+		strokeAlpha = swnvg__minf(1.0f, (1.0f - fabsf(u*2.0f - 1.0f)) * frag->strokeMult) * swnvg__minf(1.0f, v);
+
+	if (frag->type == SWNVG_SHADER_FILLGRAD) {
+		const float* m = frag->paintMat;
+		float ptx = m[0]*px + m[2]*py + m[4];
+		float pty = m[1]*px + m[3]*py + m[5];
+		float d = swnvg__clampf((swnvg__sdroundrect(ptx, pty, frag->extent[0], frag->extent[1], frag->radius) + frag->feather*0.5f) / frag->feather, 0.0f, 1.0f);
+		const float* ic = frag->innerCol.rgba;
+		const float* oc = frag->outerCol.rgba;
+		a = strokeAlpha * scissor;
+		for (i = 0; i < 4; i++)
+			result[i] = (ic[i] + (oc[i] - ic[i]) * d) * a;
+	} else if (frag->type == SWNVG_SHADER_FILLIMG) {
+		const float* m = frag->paintMat;
+		float ptx = (m[0]*px + m[2]*py + m[4]) / frag->extent[0];
+		float pty = (m[1]*px + m[3]*py + m[5]) / frag->extent[1];
+		swnvg__texColor(frag, st->tex, ptx, pty, result);
+		a = strokeAlpha * scissor;
+		for (i = 0; i < 4; i++)
+			result[i] *= frag->innerCol.rgba[i] * a;
+	} else if (frag->type == SWNVG_SHADER_SIMPLE) {
+		result[0] = result[1] = result[2] = result[3] = 1.0f;
+	} else {
+		swnvg__texColor(frag, st->tex, u, v, result);
+		for (i = 0; i < 4; i++)
+			result[i] *= scissor * frag->innerCol.rgba[i];
+	}
+
+	if ((sw->flags & NVGSW_ANTIALIAS) && strokeAlpha < frag->strokeThr)
+		return 0;
+	return 1;
+}
+
+//
+// Rasterization
+//
+
+// Attribute plane: value = a + dx * x + dy * y, evaluated at pixel centers.
+struct SWNVGplane {
+	float a, dx, dy;
+};
+typedef struct SWNVGplane SWNVGplane;
+
+static void swnvg__span(SWNVGcontext* sw, const SWNVGstate* st, int front, int y, int x0, int x1,
+						const SWNVGplane* pu, const SWNVGplane* pv)
+{
+	unsigned char* dst = &sw->pixels[y * sw->stride + x0 * 4];
+	unsigned char* stencil = &sw->stencil[y * sw->width + x0];
+	float py = y + 0.5f;
+	float u0 = pu->a + pu->dy * py;
+	float v0 = pv->a + pv->dy * py;
+	float color[4];
+	int x;
+
+	for (x = x0; x <= x1; x++, dst += 4, stencil++) {
+		if (st->stencilFunc == SWNVG_STENCIL_EQUAL0 && *stencil != 0) continue;
+		if (st->stencilFunc == SWNVG_STENCIL_NOTEQUAL0 && *stencil == 0) continue;
+
+		if (st->colorMask) {
+			// Attributes are evaluated from the plane at every pixel rather than stepped from x0,
+			// so a pixel gets the same value whichever tile clips the span.
+			float px = x + 0.5f, ia;
+			float u = u0 + pu->dx * px, v = v0 + pv->dx * px;
+			if (!swnvg__shade(sw, st, px, py, u, v, color)) continue;
+			// glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA)
+			color[3] = swnvg__clampf(color[3], 0.0f, 1.0f);
+			ia = 1.0f - color[3];
+			dst[0] = (unsigned char)swnvg__clampf(color[0]*255.0f + dst[0]*ia + 0.5f, 0.0f, 255.0f);
+			dst[1] = (unsigned char)swnvg__clampf(color[1]*255.0f + dst[1]*ia + 0.5f, 0.0f, 255.0f);
+			dst[2] = (unsigned char)swnvg__clampf(color[2]*255.0f + dst[2]*ia + 0.5f, 0.0f, 255.0f);
+			dst[3] = (unsigned char)swnvg__clampf(color[3]*255.0f + dst[3]*ia + 0.5f, 0.0f, 255.0f);
+		}
+
+		switch (st->stencilOp) {
+		case SWNVG_STENCIL_ZERO: *stencil = 0; break;
+		case SWNVG_STENCIL_INCR: if (*stencil < 0xff) (*stencil)++; break;
+		case SWNVG_STENCIL_INCR_DECR_WRAP: *stencil = (unsigned char)(*stencil + (front ? 1 : -1)); break;
+		default: break;
+		}
+	}
+}
+
+static long long swnvg__fixed(float v)
+{
+	v = swnvg__clampf(v, -SWNVG_MAX_COORD, SWNVG_MAX_COORD);
+	return (long long)floor((double)v * SWNVG_SUBPIXEL + 0.5);
+}
+
+static void swnvg__plane(SWNVGplane* p, const NVGvertex* v0, const NVGvertex* v1, const NVGvertex* v2,
+						 float a0, float a1, float a2)
+{
+	float e1x = v1->x - v0->x, e1y = v1->y - v0->y;
+	float e2x = v2->x - v0->x, e2y = v2->y - v0->y;
+	float d1 = a1 - a0, d2 = a2 - a0;
+	float det = e1x*e2y - e2x*e1y;
+	if (det == 0.0f) {
+		p->dx = p->dy = 0.0f;
+	} else {
+		p->dx = (d1*e2y - d2*e1y) / det;
+		p->dy = (d2*e1x - d1*e2x) / det;
+	}
+	p->a = a0 - p->dx * v0->x - p->dy * v0->y;
+}
+
+// Rasterizes one triangle inside clip rectangle [x0,y0,x1,y1), sampling at pixel
+// centers with the top-left fill rule so that shared edges are covered exactly once.
+static void swnvg__triangle(SWNVGcontext* sw, const SWNVGstate* st, const NVGvertex* a,
+							const NVGvertex* b, const NVGvertex* c, const int* clip)
+{
+	const long long half = SWNVG_SUBPIXEL / 2;
+	long long vx[3], vy[3], area, minx, maxx, miny, maxy;
+	long long edx[3], edy[3], bias[3];
+	const NVGvertex* v[3];
+	SWNVGplane pu, pv;
+	int front, i, xs, xe, ys, ye, y;
+
+	vx[0] = swnvg__fixed(a->x); vy[0] = swnvg__fixed(a->y);
+	vx[1] = swnvg__fixed(b->x); vy[1] = swnvg__fixed(b->y);
+	vx[2] = swnvg__fixed(c->x); vy[2] = swnvg__fixed(c->y);
+
+	area = (vx[1]-vx[0])*(vy[2]-vy[0]) - (vx[2]-vx[0])*(vy[1]-vy[0]);
+	if (area == 0) return;
+
+	// GL front faces are counter-clockwise in window coordinates, whose y axis
+	// points up; in nanovg's y down coordinates they have negative area.
+	front = area < 0;
+	if (st->cull && !front) return;
+
+	v[0] = a; v[1] = b; v[2] = c;
+	if (area < 0) {
+		long long t;
+		t = vx[1]; vx[1] = vx[2]; vx[2] = t;
+		t = vy[1]; vy[1] = vy[2]; vy[2] = t;
+		v[1] = c; v[2] = b;
+	}
+
+	minx = vx[0] < vx[1] ? (vx[0] < vx[2] ? vx[0] : vx[2]) : (vx[1] < vx[2] ? vx[1] : vx[2]);
+	maxx = vx[0] > vx[1] ? (vx[0] > vx[2] ? vx[0] : vx[2]) : (vx[1] > vx[2] ? vx[1] : vx[2]);
+	miny = vy[0] < vy[1] ? (vy[0] < vy[2] ? vy[0] : vy[2]) : (vy[1] < vy[2] ? vy[1] : vy[2]);
+	maxy = vy[0] > vy[1] ? (vy[0] > vy[2] ? vy[0] : vy[2]) : (vy[1] > vy[2] ? vy[1] : vy[2]);
+
+	// Pixels whose centers are inside the bounding box.
+	xs = (int)-swnvg__floorDiv(-(minx - half), SWNVG_SUBPIXEL);
+	xe = (int)swnvg__floorDiv(maxx - half, SWNVG_SUBPIXEL);
+	ys = (int)-swnvg__floorDiv(-(miny - half), SWNVG_SUBPIXEL);
+	ye = (int)swnvg__floorDiv(maxy - half, SWNVG_SUBPIXEL);
+	xs = swnvg__maxi(xs, clip[0]);
+	ys = swnvg__maxi(ys, clip[1]);
+	xe = swnvg__mini(xe, clip[2] - 1);
+	ye = swnvg__mini(ye, clip[3] - 1);
+	if (xs > xe || ys > ye) return;
+
+	for (i = 0; i < 3; i++) {
+		int j = (i + 1) % 3;
+		edx[i] = vx[j] - vx[i];
+		edy[i] = vy[j] - vy[i];
+		// Top-left rule: pixel centers exactly on top or left edges are inside.
+		bias[i] = (edy[i] < 0 || (edy[i] == 0 && edx[i] > 0)) ? 0 : 1;
+	}
+
+	swnvg__plane(&pu, v[0], v[1], v[2], v[0]->u, v[1]->u, v[2]->u);
+	swnvg__plane(&pv, v[0], v[1], v[2], v[0]->v, v[1]->v, v[2]->v);
+
+	for (y = ys; y <= ye; y++) {
+		long long py = (long long)y * SWNVG_SUBPIXEL + half;
+		int lo = xs, hi = xe;
+		for (i = 0; i < 3; i++) {
+			// Edge function at pixel x is e = c + s * x, pixel is inside when e >= bias.
+			long long ce = edx[i] * (py - vy[i]) - edy[i] * (half - vx[i]);
+			long long s = -edy[i] * SWNVG_SUBPIXEL;
+			if (s == 0) {
+				if (ce < bias[i]) { lo = 1; hi = 0; break; }
+			} else if (s > 0) {
+				long long x = -swnvg__floorDiv(-(bias[i] - ce), s);
+				if (x > lo) lo = x > hi ? hi + 1 : (int)x;
+			} else {
+				long long x = swnvg__floorDiv(ce - bias[i], -s);
+				if (x < hi) hi = x < lo ? lo - 1 : (int)x;
+			}
+		}
+		if (lo <= hi)
+			swnvg__span(sw, st, front, y, lo, hi, &pu, &pv);
+	}
+}
+
+static void swnvg__drawArrays(SWNVGcontext* sw, const SWNVGstate* st, int mode, int first, int count, const int* clip)
+{
+	const NVGvertex* verts = &sw->verts[first];
+	int i;
+
+	if (mode == SWNVG_TRIANGLES) {
+		for (i = 0; i + 2 < count; i += 3)
+			swnvg__triangle(sw, st, &verts[i], &verts[i+1], &verts[i+2], clip);
+	} else if (mode == SWNVG_TRIANGLE_STRIP) {
+		for (i = 0; i + 2 < count; i++) {
+			if (i & 1)
+				swnvg__triangle(sw, st, &verts[i+1], &verts[i], &verts[i+2], clip);
+			else
+				swnvg__triangle(sw, st, &verts[i], &verts[i+1], &verts[i+2], clip);
+		}
+	} else {
+		for (i = 1; i + 1 < count; i++)
+			swnvg__triangle(sw, st, &verts[0], &verts[i], &verts[i+1], clip);
+	}
+}
+
+static void swnvg__setState(SWNVGcontext* sw, SWNVGstate* st, int cull, int colorMask, int stencilFunc, int stencilOp,
+							int uniformOffset, int image)
+{
+	st->cull = cull;
+	st->colorMask = colorMask;
+	st->stencilFunc = stencilFunc;
+	st->stencilOp = stencilOp;
+	st->frag = &sw->uniforms[uniformOffset];
+	st->tex = image != 0 ? swnvg__findTexture(sw, image) : NULL;
+}
+
+static void swnvg__fill(SWNVGcontext* sw, SWNVGcall* call, const int* clip)
+{
+	SWNVGpath* paths = &sw->paths[call->pathOffset];
+	int i, npaths = call->pathCount;
+	SWNVGstate st;
+
+	// Draw shapes
+	swnvg__setState(sw, &st, 0, 0, SWNVG_STENCIL_ALWAYS, SWNVG_STENCIL_INCR_DECR_WRAP, call->uniformOffset, 0);
+	for (i = 0; i < npaths; i++)
+		swnvg__drawArrays(sw, &st, SWNVG_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount, clip);
+
+	// Draw anti-aliased pixels
+	if (sw->flags & NVGSW_ANTIALIAS) {
+		swnvg__setState(sw, &st, 1, 1, SWNVG_STENCIL_EQUAL0, SWNVG_STENCIL_KEEP, call->uniformOffset + 1, call->image);
+		// Draw fringes
+		for (i = 0; i < npaths; i++)
+			swnvg__drawArrays(sw, &st, SWNVG_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount, clip);
+	}
+
+	// Draw fill
+	swnvg__setState(sw, &st, 1, 1, SWNVG_STENCIL_NOTEQUAL0, SWNVG_STENCIL_ZERO, call->uniformOffset + 1, call->image);
+	swnvg__drawArrays(sw, &st, SWNVG_TRIANGLES, call->triangleOffset, call->triangleCount, clip);
+}
+
+static void swnvg__convexFill(SWNVGcontext* sw, SWNVGcall* call, const int* clip)
+{
+	SWNVGpath* paths = &sw->paths[call->pathOffset];
+	int i, npaths = call->pathCount;
+	SWNVGstate st;
+
+	swnvg__setState(sw, &st, 1, 1, SWNVG_STENCIL_ALWAYS, SWNVG_STENCIL_KEEP, call->uniformOffset, call->image);
+	for (i = 0; i < npaths; i++)
+		swnvg__drawArrays(sw, &st, SWNVG_TRIANGLE_FAN, paths[i].fillOffset, paths[i].fillCount, clip);
+	if (sw->flags & NVGSW_ANTIALIAS) {
+		// Draw fringes
+		for (i = 0; i < npaths; i++)
+			swnvg__drawArrays(sw, &st, SWNVG_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount, clip);
+	}
+}
+
+static void swnvg__stroke(SWNVGcontext* sw, SWNVGcall* call, const int* clip)
+{
+	SWNVGpath* paths = &sw->paths[call->pathOffset];
+	int npaths = call->pathCount, i;
+	SWNVGstate st;
+
+	if (sw->flags & NVGSW_STENCIL_STROKES) {
+		// Fill the stroke base without overlap
+		swnvg__setState(sw, &st, 1, 1, SWNVG_STENCIL_EQUAL0, SWNVG_STENCIL_INCR, call->uniformOffset + 1, call->image);
+		for (i = 0; i < npaths; i++)
+			swnvg__drawArrays(sw, &st, SWNVG_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount, clip);
+
+		// Draw anti-aliased pixels.
+		swnvg__setState(sw, &st, 1, 1, SWNVG_STENCIL_EQUAL0, SWNVG_STENCIL_KEEP, call->uniformOffset, call->image);
+		for (i = 0; i < npaths; i++)
+			swnvg__drawArrays(sw, &st, SWNVG_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount, clip);
+
+		// Clear stencil buffer.
+		swnvg__setState(sw, &st, 1, 0, SWNVG_STENCIL_ALWAYS, SWNVG_STENCIL_ZERO, call->uniformOffset, 0);
+		for (i = 0; i < npaths; i++)
+			swnvg__drawArrays(sw, &st, SWNVG_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount, clip);
+	} else {
+		swnvg__setState(sw, &st, 1, 1, SWNVG_STENCIL_ALWAYS, SWNVG_STENCIL_KEEP, call->uniformOffset, call->image);
+		// Draw Strokes
+		for (i = 0; i < npaths; i++)
+			swnvg__drawArrays(sw, &st, SWNVG_TRIANGLE_STRIP, paths[i].strokeOffset, paths[i].strokeCount, clip);
+	}
+}
+
+static void swnvg__triangles(SWNVGcontext* sw, SWNVGcall* call, const int* clip)
+{
+	SWNVGstate st;
+	swnvg__setState(sw, &st, 1, 1, SWNVG_STENCIL_ALWAYS, SWNVG_STENCIL_KEEP, call->uniformOffset, call->image);
+	swnvg__drawArrays(sw, &st, SWNVG_TRIANGLES, call->triangleOffset, call->triangleCount, clip);
+}
+
+static void swnvg__renderCancel(void* uptr) {
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	sw->nverts = 0;
+	sw->npaths = 0;
+	sw->ncalls = 0;
+	sw->nuniforms = 0;
+}
+
+static void swnvg__call(SWNVGcontext* sw, SWNVGcall* call, const int* clip)
+{
+	if (call->type == SWNVG_FILL)
+		swnvg__fill(sw, call, clip);
+	else if (call->type == SWNVG_CONVEXFILL)
+		swnvg__convexFill(sw, call, clip);
+	else if (call->type == SWNVG_STROKE)
+		swnvg__stroke(sw, call, clip);
+	else if (call->type == SWNVG_TRIANGLES_CALL)
+		swnvg__triangles(sw, call, clip);
+}
+
+#ifndef NANOVG_SW_NO_THREADS
+
+static void swnvg__tileRange(SWNVGcontext* sw, const SWNVGcall* call, int* range)
+{
+	range[0] = swnvg__maxi((int)floorf(call->bounds[0]) / SWNVG_TILE_SIZE, 0);
+	range[1] = swnvg__maxi((int)floorf(call->bounds[1]) / SWNVG_TILE_SIZE, 0);
+	range[2] = swnvg__mini((int)floorf(call->bounds[2]) / SWNVG_TILE_SIZE, sw->ntilesx - 1);
+	range[3] = swnvg__mini((int)floorf(call->bounds[3]) / SWNVG_TILE_SIZE, sw->ntilesy - 1);
+}
+
+// Bins the calls of the frame into screen tiles, keeping submission order in every tile.
+static int swnvg__binCalls(SWNVGcontext* sw)
+{
+	int ntiles, i, x, y, total = 0, range[4];
+
+	sw->ntilesx = (sw->width + SWNVG_TILE_SIZE-1) / SWNVG_TILE_SIZE;
+	sw->ntilesy = (sw->height + SWNVG_TILE_SIZE-1) / SWNVG_TILE_SIZE;
+	ntiles = sw->ntilesx * sw->ntilesy;
+
+	if (ntiles+1 > sw->ctileOffsets) {
+		int* offsets = (int*)realloc(sw->tileOffsets, sizeof(int) * (ntiles+1));
+		if (offsets == NULL) return 0;
+		sw->tileOffsets = offsets;
+		sw->ctileOffsets = ntiles+1;
+	}
+	memset(sw->tileOffsets, 0, sizeof(int) * (ntiles+1));
+
+	// Count calls per tile.
+	for (i = 0; i < sw->ncalls; i++) {
+		swnvg__tileRange(sw, &sw->calls[i], range);
+		for (y = range[1]; y <= range[3]; y++)
+			for (x = range[0]; x <= range[2]; x++)
+				sw->tileOffsets[y * sw->ntilesx + x + 1]++;
+	}
+	for (i = 0; i < ntiles; i++) {
+		total += sw->tileOffsets[i+1];
+		sw->tileOffsets[i+1] = total;
+	}
+
+	if (total > sw->ctileCalls) {
+		int ctileCalls = swnvg__maxi(total, 1024) + sw->ctileCalls/2; // 1.5x Overallocate
+		int* calls = (int*)realloc(sw->tileCalls, sizeof(int) * ctileCalls);
+		if (calls == NULL) return 0;
+		sw->tileCalls = calls;
+		sw->ctileCalls = ctileCalls;
+	}
+
+	// Fill the bins, tileOffsets[i] is used as the write cursor of tile i
+	// and ends up at the start of tile i+1, it is shifted back afterwards.
+	for (i = 0; i < sw->ncalls; i++) {
+		swnvg__tileRange(sw, &sw->calls[i], range);
+		for (y = range[1]; y <= range[3]; y++)
+			for (x = range[0]; x <= range[2]; x++)
+				sw->tileCalls[sw->tileOffsets[y * sw->ntilesx + x]++] = i;
+	}
+	for (i = ntiles; i > 0; i--)
+		sw->tileOffsets[i] = sw->tileOffsets[i-1];
+	sw->tileOffsets[0] = 0;
+
+	return 1;
+}
+
+static void swnvg__renderTile(SWNVGcontext* sw, int tile)
+{
+	int clip[4], i;
+	clip[0] = (tile % sw->ntilesx) * SWNVG_TILE_SIZE;
+	clip[1] = (tile / sw->ntilesx) * SWNVG_TILE_SIZE;
+	clip[2] = swnvg__mini(clip[0] + SWNVG_TILE_SIZE, sw->width);
+	clip[3] = swnvg__mini(clip[1] + SWNVG_TILE_SIZE, sw->height);
+
+	for (i = sw->tileOffsets[tile]; i < sw->tileOffsets[tile+1]; i++)
+		swnvg__call(sw, &sw->calls[sw->tileCalls[i]], clip);
+}
+
+#ifdef _WIN32
+static void swnvg__mutexInit(SWNVGmutex* m) { InitializeCriticalSection(m); }
+static void swnvg__mutexDestroy(SWNVGmutex* m) { DeleteCriticalSection(m); }
+static void swnvg__lock(SWNVGmutex* m) { EnterCriticalSection(m); }
+static void swnvg__unlock(SWNVGmutex* m) { LeaveCriticalSection(m); }
+static void swnvg__condInit(SWNVGcond* c) { InitializeConditionVariable(c); }
+static void swnvg__condDestroy(SWNVGcond* c) { NVG_NOTUSED(c); }
+static void swnvg__condWait(SWNVGcond* c, SWNVGmutex* m) { SleepConditionVariableCS(c, m, INFINITE); }
+static void swnvg__condBroadcast(SWNVGcond* c) { WakeAllConditionVariable(c); }
+#else
+static void swnvg__mutexInit(SWNVGmutex* m) { pthread_mutex_init(m, NULL); }
+static void swnvg__mutexDestroy(SWNVGmutex* m) { pthread_mutex_destroy(m); }
+static void swnvg__lock(SWNVGmutex* m) { pthread_mutex_lock(m); }
+static void swnvg__unlock(SWNVGmutex* m) { pthread_mutex_unlock(m); }
+static void swnvg__condInit(SWNVGcond* c) { pthread_cond_init(c, NULL); }
+static void swnvg__condDestroy(SWNVGcond* c) { pthread_cond_destroy(c); }
+static void swnvg__condWait(SWNVGcond* c, SWNVGmutex* m) { pthread_cond_wait(c, m); }
+static void swnvg__condBroadcast(SWNVGcond* c) { pthread_cond_broadcast(c); }
+#endif
+
+static void swnvg__renderTiles(SWNVGworkers* w)
+{
+	int ntiles = w->sw->ntilesx * w->sw->ntilesy;
+	for (;;) {
+		int tile;
+		swnvg__lock(&w->lock);
+		tile = w->nextTile++;
+		swnvg__unlock(&w->lock);
+		if (tile >= ntiles) break;
+		swnvg__renderTile(w->sw, tile);
+	}
+}
+
+static void swnvg__workerLoop(SWNVGworkers* w)
+{
+	int generation = 0;
+	swnvg__lock(&w->lock);
+	for (;;) {
+		while (w->generation == generation && !w->quit)
+			swnvg__condWait(&w->start, &w->lock);
+		if (w->quit) break;
+		generation = w->generation;
+		swnvg__unlock(&w->lock);
+
+		swnvg__renderTiles(w);
+
+		swnvg__lock(&w->lock);
+		if (--w->busy == 0)
+			swnvg__condBroadcast(&w->done);
+	}
+	swnvg__unlock(&w->lock);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI swnvg__worker(LPVOID arg) { swnvg__workerLoop((SWNVGworkers*)arg); return 0; }
+#else
+static void* swnvg__worker(void* arg) { swnvg__workerLoop((SWNVGworkers*)arg); return NULL; }
+#endif
+
+static void swnvg__deleteWorkers(SWNVGworkers* w)
+{
+	int i;
+	if (w == NULL) return;
+
+	swnvg__lock(&w->lock);
+	w->quit = 1;
+	swnvg__condBroadcast(&w->start);
+	swnvg__unlock(&w->lock);
+
+	for (i = 0; i < w->nthreads; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(w->threads[i], INFINITE);
+		CloseHandle(w->threads[i]);
+#else
+		pthread_join(w->threads[i], NULL);
+#endif
+	}
+
+	swnvg__condDestroy(&w->start);
+	swnvg__condDestroy(&w->done);
+	swnvg__mutexDestroy(&w->lock);
+	free(w->threads);
+	free(w);
+}
+
+static SWNVGworkers* swnvg__createWorkers(SWNVGcontext* sw, int nthreads)
+{
+	SWNVGworkers* w = (SWNVGworkers*)malloc(sizeof(SWNVGworkers));
+	if (w == NULL) return NULL;
+	memset(w, 0, sizeof(SWNVGworkers));
+	w->sw = sw;
+
+	w->threads = (SWNVGthread*)malloc(sizeof(SWNVGthread) * nthreads);
+	if (w->threads == NULL) {
+		free(w);
+		return NULL;
+	}
+
+	swnvg__mutexInit(&w->lock);
+	swnvg__condInit(&w->start);
+	swnvg__condInit(&w->done);
+
+	for (w->nthreads = 0; w->nthreads < nthreads; w->nthreads++) {
+#ifdef _WIN32
+		w->threads[w->nthreads] = CreateThread(NULL, 0, swnvg__worker, w, 0, NULL);
+		if (w->threads[w->nthreads] == NULL) break;
+#else
+		if (pthread_create(&w->threads[w->nthreads], NULL, swnvg__worker, w) != 0) break;
+#endif
+	}
+
+	if (w->nthreads == 0) {
+		swnvg__deleteWorkers(w);
+		return NULL;
+	}
+
+	return w;
+}
+
+static int swnvg__flushThreaded(SWNVGcontext* sw)
+{
+	SWNVGworkers* w = sw->workers;
+	if (w == NULL || !swnvg__binCalls(sw)) return 0;
+
+	swnvg__lock(&w->lock);
+	w->nextTile = 0;
+	w->busy = w->nthreads;
+	w->generation++;
+	swnvg__condBroadcast(&w->start);
+	swnvg__unlock(&w->lock);
+
+	swnvg__renderTiles(w);
+
+	swnvg__lock(&w->lock);
+	while (w->busy > 0)
+		swnvg__condWait(&w->done, &w->lock);
+	swnvg__unlock(&w->lock);
+
+	return 1;
+}
+
+#endif // NANOVG_SW_NO_THREADS
+
+static void swnvg__renderFlush(void* uptr)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	int i;
+
+	NVG_TRACE_BEGIN("swnvg__renderFlush");
+
+	if (sw->ncalls > 0 && sw->pixels != NULL) {
+		int clip[4];
+#ifndef NANOVG_SW_NO_THREADS
+		if (!swnvg__flushThreaded(sw))
+#endif
+		{
+			clip[0] = 0;
+			clip[1] = 0;
+			clip[2] = sw->width;
+			clip[3] = sw->height;
+			for (i = 0; i < sw->ncalls; i++)
+				swnvg__call(sw, &sw->calls[i], clip);
+		}
+	}
+
+	// Reset calls
+	sw->nverts = 0;
+	sw->npaths = 0;
+	sw->ncalls = 0;
+	sw->nuniforms = 0;
+
+	NVG_TRACE_END("swnvg__renderFlush");
+}
+
+static int swnvg__maxVertCount(const NVGpath* paths, int npaths)
+{
+	int i, count = 0;
+	for (i = 0; i < npaths; i++) {
+		count += paths[i].nfill;
+		count += paths[i].nstroke;
+	}
+	return count;
+}
+
+static SWNVGcall* swnvg__allocCall(SWNVGcontext* sw)
+{
+	SWNVGcall* ret = NULL;
+	if (sw->ncalls+1 > sw->ccalls) {
+		SWNVGcall* calls;
+		int ccalls = swnvg__maxi(sw->ncalls+1, 128) + sw->ccalls/2; // 1.5x Overallocate
+		calls = (SWNVGcall*)realloc(sw->calls, sizeof(SWNVGcall) * ccalls);
+		if (calls == NULL) return NULL;
+		sw->calls = calls;
+		sw->ccalls = ccalls;
+	}
+	ret = &sw->calls[sw->ncalls++];
+	memset(ret, 0, sizeof(SWNVGcall));
+	return ret;
+}
+
+static int swnvg__allocPaths(SWNVGcontext* sw, int n)
+{
+	int ret = 0;
+	if (sw->npaths+n > sw->cpaths) {
+		SWNVGpath* paths;
+		int cpaths = swnvg__maxi(sw->npaths + n, 128) + sw->cpaths/2; // 1.5x Overallocate
+		paths = (SWNVGpath*)realloc(sw->paths, sizeof(SWNVGpath) * cpaths);
+		if (paths == NULL) return -1;
+		sw->paths = paths;
+		sw->cpaths = cpaths;
+	}
+	ret = sw->npaths;
+	sw->npaths += n;
+	return ret;
+}
+
+static int swnvg__allocVerts(SWNVGcontext* sw, int n)
+{
+	int ret = 0;
+	if (sw->nverts+n > sw->cverts) {
+		NVGvertex* verts;
+		int cverts = swnvg__maxi(sw->nverts + n, 4096) + sw->cverts/2; // 1.5x Overallocate
+		verts = (NVGvertex*)realloc(sw->verts, sizeof(NVGvertex) * cverts);
+		if (verts == NULL) return -1;
+		sw->verts = verts;
+		sw->cverts = cverts;
+	}
+	ret = sw->nverts;
+	sw->nverts += n;
+	return ret;
+}
+
+static int swnvg__allocFragUniforms(SWNVGcontext* sw, int n)
+{
+	int ret = 0;
+	if (sw->nuniforms+n > sw->cuniforms) {
+		SWNVGfragUniforms* uniforms;
+		int cuniforms = swnvg__maxi(sw->nuniforms+n, 128) + sw->cuniforms/2; // 1.5x Overallocate
+		uniforms = (SWNVGfragUniforms*)realloc(sw->uniforms, sizeof(SWNVGfragUniforms) * cuniforms);
+		if (uniforms == NULL) return -1;
+		sw->uniforms = uniforms;
+		sw->cuniforms = cuniforms;
+	}
+	ret = sw->nuniforms;
+	sw->nuniforms += n;
+	return ret;
+}
+
+static void swnvg__callBounds(SWNVGcall* call, const NVGvertex* verts, int nverts)
+{
+	int i;
+	call->bounds[0] = call->bounds[1] = 1e6f;
+	call->bounds[2] = call->bounds[3] = -1e6f;
+	for (i = 0; i < nverts; i++) {
+		call->bounds[0] = swnvg__minf(call->bounds[0], verts[i].x);
+		call->bounds[1] = swnvg__minf(call->bounds[1], verts[i].y);
+		call->bounds[2] = swnvg__maxf(call->bounds[2], verts[i].x);
+		call->bounds[3] = swnvg__maxf(call->bounds[3], verts[i].y);
+	}
+}
+
+static void swnvg__vset(NVGvertex* vtx, float x, float y, float u, float v)
+{
+	vtx->x = x;
+	vtx->y = y;
+	vtx->u = u;
+	vtx->v = v;
+}
+
+static void swnvg__renderFill(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe,
+							  const float* bounds, const NVGpath* paths, int npaths)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	SWNVGcall* call = swnvg__allocCall(sw);
+	NVGvertex* quad;
+	SWNVGfragUniforms* frag;
+	int i, maxverts, offset, first;
+
+	if (call == NULL) return;
+
+	call->type = SWNVG_FILL;
+	call->pathOffset = swnvg__allocPaths(sw, npaths);
+	if (call->pathOffset == -1) goto error;
+	call->pathCount = npaths;
+	call->image = paint->image;
+
+	if (npaths == 1 && paths[0].convex)
+		call->type = SWNVG_CONVEXFILL;
+
+	// Allocate vertices for all the paths.
+	maxverts = swnvg__maxVertCount(paths, npaths) + 6;
+	offset = first = swnvg__allocVerts(sw, maxverts);
+	if (offset == -1) goto error;
+
+	for (i = 0; i < npaths; i++) {
+		SWNVGpath* copy = &sw->paths[call->pathOffset + i];
+		const NVGpath* path = &paths[i];
+		memset(copy, 0, sizeof(SWNVGpath));
+		if (path->nfill > 0) {
+			copy->fillOffset = offset;
+			copy->fillCount = path->nfill;
+			memcpy(&sw->verts[offset], path->fill, sizeof(NVGvertex) * path->nfill);
+			offset += path->nfill;
+		}
+		if (path->nstroke > 0) {
+			copy->strokeOffset = offset;
+			copy->strokeCount = path->nstroke;
+			memcpy(&sw->verts[offset], path->stroke, sizeof(NVGvertex) * path->nstroke);
+			offset += path->nstroke;
+		}
+	}
+
+	// Quad
+	call->triangleOffset = offset;
+	call->triangleCount = 6;
+	quad = &sw->verts[call->triangleOffset];
+	swnvg__vset(&quad[0], bounds[0], bounds[3], 0.5f, 1.0f);
+	swnvg__vset(&quad[1], bounds[2], bounds[3], 0.5f, 1.0f);
+	swnvg__vset(&quad[2], bounds[2], bounds[1], 0.5f, 1.0f);
+
+	swnvg__vset(&quad[3], bounds[0], bounds[3], 0.5f, 1.0f);
+	swnvg__vset(&quad[4], bounds[2], bounds[1], 0.5f, 1.0f);
+	swnvg__vset(&quad[5], bounds[0], bounds[1], 0.5f, 1.0f);
+
+	swnvg__callBounds(call, &sw->verts[first], maxverts);
+
+	// Setup uniforms for draw calls
+	if (call->type == SWNVG_FILL) {
+		call->uniformOffset = swnvg__allocFragUniforms(sw, 2);
+		if (call->uniformOffset == -1) goto error;
+		// Simple shader for stencil
+		frag = &sw->uniforms[call->uniformOffset];
+		memset(frag, 0, sizeof(*frag));
+		frag->strokeThr = -1.0f;
+		frag->type = SWNVG_SHADER_SIMPLE;
+		// Fill shader
+		swnvg__convertPaint(sw, &sw->uniforms[call->uniformOffset + 1], paint, scissor, fringe, fringe, -1.0f);
+	} else {
+		call->uniformOffset = swnvg__allocFragUniforms(sw, 1);
+		if (call->uniformOffset == -1) goto error;
+		// Fill shader
+		swnvg__convertPaint(sw, &sw->uniforms[call->uniformOffset], paint, scissor, fringe, fringe, -1.0f);
+	}
+
+	return;
+
+error:
+	// We get here if call alloc was ok, but something else is not.
+	// Roll back the last call to prevent drawing it.
+	if (sw->ncalls > 0) sw->ncalls--;
+}
+
+static void swnvg__renderStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor, float fringe,
+								float strokeWidth, const NVGpath* paths, int npaths)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	SWNVGcall* call = swnvg__allocCall(sw);
+	int i, maxverts, offset, first;
+
+	if (call == NULL) return;
+
+	call->type = SWNVG_STROKE;
+	call->pathOffset = swnvg__allocPaths(sw, npaths);
+	if (call->pathOffset == -1) goto error;
+	call->pathCount = npaths;
+	call->image = paint->image;
+
+	// Allocate vertices for all the paths.
+	maxverts = swnvg__maxVertCount(paths, npaths);
+	offset = first = swnvg__allocVerts(sw, maxverts);
+	if (offset == -1) goto error;
+
+	for (i = 0; i < npaths; i++) {
+		SWNVGpath* copy = &sw->paths[call->pathOffset + i];
+		const NVGpath* path = &paths[i];
+		memset(copy, 0, sizeof(SWNVGpath));
+		if (path->nstroke) {
+			copy->strokeOffset = offset;
+			copy->strokeCount = path->nstroke;
+			memcpy(&sw->verts[offset], path->stroke, sizeof(NVGvertex) * path->nstroke);
+			offset += path->nstroke;
+		}
+	}
+	swnvg__callBounds(call, &sw->verts[first], offset - first);
+
+	if (sw->flags & NVGSW_STENCIL_STROKES) {
+		// Fill shader
+		call->uniformOffset = swnvg__allocFragUniforms(sw, 2);
+		if (call->uniformOffset == -1) goto error;
+
+		swnvg__convertPaint(sw, &sw->uniforms[call->uniformOffset], paint, scissor, strokeWidth, fringe, -1.0f);
+		swnvg__convertPaint(sw, &sw->uniforms[call->uniformOffset + 1], paint, scissor, strokeWidth, fringe, 1.0f - 0.5f/255.0f);
+
+	} else {
+		// Fill shader
+		call->uniformOffset = swnvg__allocFragUniforms(sw, 1);
+		if (call->uniformOffset == -1) goto error;
+		swnvg__convertPaint(sw, &sw->uniforms[call->uniformOffset], paint, scissor, strokeWidth, fringe, -1.0f);
+	}
+
+	return;
+
+error:
+	// We get here if call alloc was ok, but something else is not.
+	// Roll back the last call to prevent drawing it.
+	if (sw->ncalls > 0) sw->ncalls--;
+}
+
+static void swnvg__renderTriangles(void* uptr, NVGpaint* paint, NVGscissor* scissor,
+								   const NVGvertex* verts, int nverts)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	SWNVGcall* call = swnvg__allocCall(sw);
+	SWNVGfragUniforms* frag;
+
+	if (call == NULL) return;
+
+	call->type = SWNVG_TRIANGLES_CALL;
+	call->image = paint->image;
+
+	// Allocate vertices for all the paths.
+	call->triangleOffset = swnvg__allocVerts(sw, nverts);
+	if (call->triangleOffset == -1) goto error;
+	call->triangleCount = nverts;
+
+	memcpy(&sw->verts[call->triangleOffset], verts, sizeof(NVGvertex) * nverts);
+	swnvg__callBounds(call, verts, nverts);
+
+	// Fill shader
+	call->uniformOffset = swnvg__allocFragUniforms(sw, 1);
+	if (call->uniformOffset == -1) goto error;
+	frag = &sw->uniforms[call->uniformOffset];
+	swnvg__convertPaint(sw, frag, paint, scissor, 1.0f, 1.0f, -1.0f);
+	frag->type = SWNVG_SHADER_IMG;
+	if (paint->distScale > 0.0f) {
+		// Distance field text, the scale goes in the unused radius.
+		frag->texType = 3;
+		frag->radius = paint->distScale;
+	}
+
+	return;
+
+error:
+	// We get here if call alloc was ok, but something else is not.
+	// Roll back the last call to prevent drawing it.
+	if (sw->ncalls > 0) sw->ncalls--;
+}
+
+static void swnvg__renderDelete(void* uptr)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)uptr;
+	int i;
+	if (sw == NULL) return;
+
+	for (i = 0; i < sw->ntextures; i++)
+		free(sw->textures[i].data);
+	free(sw->textures);
+
+#ifndef NANOVG_SW_NO_THREADS
+	swnvg__deleteWorkers(sw->workers);
+#endif
+
+	free(sw->stencil);
+	free(sw->tileOffsets);
+	free(sw->tileCalls);
+	free(sw->paths);
+	free(sw->verts);
+	free(sw->uniforms);
+	free(sw->calls);
+
+	free(sw);
+}
+
+
+NVGcontext* nvgCreateSW(int flags)
+{
+	NVGparams params;
+	NVGcontext* ctx = NULL;
+	SWNVGcontext* sw = (SWNVGcontext*)malloc(sizeof(SWNVGcontext));
+	if (sw == NULL) goto error;
+	memset(sw, 0, sizeof(SWNVGcontext));
+
+	memset(&params, 0, sizeof(params));
+	params.renderCreate = swnvg__renderCreate;
+	params.renderCreateTexture = swnvg__renderCreateTexture;
+	params.renderDeleteTexture = swnvg__renderDeleteTexture;
+	params.renderUpdateTexture = swnvg__renderUpdateTexture;
+	params.renderGetTextureSize = swnvg__renderGetTextureSize;
+	params.renderViewport = swnvg__renderViewport;
+	params.renderCancel = swnvg__renderCancel;
+	params.renderFlush = swnvg__renderFlush;
+	params.renderFill = swnvg__renderFill;
+	params.renderStroke = swnvg__renderStroke;
+	params.renderTriangles = swnvg__renderTriangles;
+	params.renderDelete = swnvg__renderDelete;
+	params.userPtr = sw;
+	params.edgeAntiAlias = flags & NVGSW_ANTIALIAS ? 1 : 0;
+
+	sw->flags = flags;
+
+	ctx = nvgCreateInternal(&params);
+	if (ctx == NULL) goto error;
+
+	return ctx;
+
+error:
+	// 'sw' is freed by nvgDeleteInternal.
+	if (ctx != NULL) nvgDeleteInternal(ctx);
+	return NULL;
+}
+
+void nvgDeleteSW(NVGcontext* ctx)
+{
+	nvgDeleteInternal(ctx);
+}
+
+void nvgswSetFramebuffer(NVGcontext* ctx, unsigned char* pixels, int w, int h, int stride)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)nvgInternalParams(ctx)->userPtr;
+
+	if (pixels != NULL && w * h > sw->cstencil) {
+		unsigned char* stencil = (unsigned char*)realloc(sw->stencil, w * h);
+		if (stencil == NULL) {
+			sw->pixels = NULL;
+			return;
+		}
+		sw->stencil = stencil;
+		sw->cstencil = w * h;
+	}
+
+	sw->pixels = pixels;
+	sw->width = pixels != NULL ? w : 0;
+	sw->height = pixels != NULL ? h : 0;
+	sw->stride = stride;
+	if (sw->stencil != NULL)
+		memset(sw->stencil, 0, sw->cstencil);
+}
+
+void nvgswClear(NVGcontext* ctx, NVGcolor color)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)nvgInternalParams(ctx)->userPtr;
+	unsigned char c[4];
+	int x, y;
+
+	if (sw->pixels == NULL) return;
+
+	color = swnvg__premulColor(color);
+	c[0] = (unsigned char)(swnvg__clampf(color.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+	c[1] = (unsigned char)(swnvg__clampf(color.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+	c[2] = (unsigned char)(swnvg__clampf(color.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+	c[3] = (unsigned char)(swnvg__clampf(color.a, 0.0f, 1.0f) * 255.0f + 0.5f);
+
+	for (y = 0; y < sw->height; y++) {
+		unsigned char* row = &sw->pixels[y * sw->stride];
+		for (x = 0; x < sw->width; x++)
+			memcpy(&row[x*4], c, 4);
+	}
+	memset(sw->stencil, 0, sw->width * sw->height);
+}
+
+void nvgswSetThreads(NVGcontext* ctx, int nthreads)
+{
+	SWNVGcontext* sw = (SWNVGcontext*)nvgInternalParams(ctx)->userPtr;
+#ifndef NANOVG_SW_NO_THREADS
+	int nworkers = nthreads > 1 ? nthreads - 1 : 0;
+	if (sw->workers != NULL && sw->workers->nthreads == nworkers) return;
+
+	swnvg__deleteWorkers(sw->workers);
+	sw->workers = NULL;
+	if (nworkers > 0)
+		sw->workers = swnvg__createWorkers(sw, nworkers);
+#else
+	NVG_NOTUSED(sw);
+	NVG_NOTUSED(nthreads);
+#endif
+}
+
+#endif /* NANOVG_SW_IMPLEMENTATION */
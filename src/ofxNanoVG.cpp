@@ -3,6 +3,23 @@
 #define NANOVG_GL2_IMPLEMENTATION
 #include "nanovg_gl.h"
 
+#define NANOVG_SW_IMPLEMENTATION
+#include "nanovg_sw.h"
+
+#define NANOVG_NULL_IMPLEMENTATION
+#include "nanovg_null.h"
+
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 OFX_NANOVG_BEGIN_NAMESPACE
 
 #pragma mark - FrameBuffer
@@ -205,19 +222,37 @@ void RadialGradient::stroke(Canvas& canvas) const
 Image::~Image()
 {}
 
-void Image::upload(NVGcontext* ctx) const
+int Image::upload(Canvas& canvas) const
 {
-	if (image) nvgDeleteImage(ctx, image);
-	if (tex->getTextureData().textureTarget != GL_TEXTURE_2D)
-		ofLogError("ofxNanoVG::Image") << "texture target should be GL_TEXTURE_2D";
+	if (pixels)
+	{
+		if (pixels->getNumChannels() != 4)
+		{
+			ofLogError("ofxNanoVG::Image") << "pixels should be RGBA";
+			return 0;
+		}
 		
-	image = nvglCreateImageFromHandle(ctx, tex->getTextureData().textureID, tex->getWidth(), tex->getHeight(), flags);
+		// pixel images are owned by the context
+		return canvas.getImage(*pixels, flags);
+	}
+	
+	// default constructed
+	if (tex == NULL) return 0;
+	
+	if (canvas.getBackend() != Backend::OPENGL)
+	{
+		ofLogError("ofxNanoVG::Image") << "texture images need the OpenGL backend, use ofPixels instead";
+		return 0;
+	}
+	
+	// texture images are owned by the canvas
+	return canvas.getImage(*tex, flags);
 }
 
 void Image::fill(Canvas& canvas) const
 {
 	NVGcontext* c = canvas.getContext();
-	upload(c);
+	int image = upload(canvas);
 	
 	NVGpaint o = nvgImagePattern(c, rect.x, rect.y, rect.width, rect.height, angle, image, alpha);
 	nvgFillPaint(c, o);
@@ -226,55 +261,435 @@ void Image::fill(Canvas& canvas) const
 void Image::stroke(Canvas& canvas) const
 {
 	NVGcontext* c = canvas.getContext();
-	upload(c);
+	int image = upload(canvas);
 	
 	NVGpaint o = nvgImagePattern(c, rect.x, rect.y, rect.width, rect.height, angle, image, alpha);
 	nvgStrokePaint(c, o);
 }
 
+#pragma mark - Path
+
+Path::Path()
+{
+	shape = nvgCreateShape();
+}
+
+Path::~Path()
+{
+	nvgDeleteShape(shape);
+}
+
+#pragma mark - DisplayList
+
+DisplayList::DisplayList()
+{
+	list = nvgCreateDisplayList();
+}
+
+DisplayList::~DisplayList()
+{
+	nvgDeleteDisplayList(list);
+}
+
+#pragma mark - FontRegistry
+
+static map<string, weak_ptr<FontRegistry::Data> > font_registry;
+static mutex font_registry_mutex;
+static bool font_registry_mapped = false;
+
+static void* mapFile(const string& path, size_t& size)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return NULL;
+	
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return NULL;
+	}
+	
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) return NULL;
+	
+	// the view keeps the mapping alive
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	
+	size = file_size.QuadPart;
+	return view;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1) return NULL;
+	
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size == 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	
+	void* view = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) return NULL;
+	
+	size = st.st_size;
+	return view;
+#endif
+}
+
+static void unmapFile(void* view, size_t size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(view);
+#else
+	munmap(view, size);
+#endif
+}
+
+FontRegistry::Data::Data(const string& path, bool mapped)
+	: path(path)
+	, bytes(NULL)
+	, size(0)
+	, mapping(NULL)
+{
+	if (mapped)
+	{
+		mapping = mapFile(path, size);
+		if (mapping)
+		{
+			// fontstash takes a non-const pointer but only reads the font
+			bytes = (unsigned char*)mapping;
+			return;
+		}
+	}
+	
+	ifstream file(path.c_str(), ios::binary);
+	if (!file) return;
+	
+	buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+	if (buffer.empty()) return;
+	
+	bytes = &buffer[0];
+	size = buffer.size();
+}
+
+FontRegistry::Data::~Data()
+{
+	if (mapping) unmapFile(mapping, size);
+}
+
+shared_ptr<FontRegistry::Data> FontRegistry::load(const string& path)
+{
+	string abs_path = ofToDataPath(path, true);
+	
+	lock_guard<mutex> lock(font_registry_mutex);
+	
+	shared_ptr<Data> data = font_registry[abs_path].lock();
+	if (data) return data;
+	
+	data = shared_ptr<Data>(new Data(abs_path, font_registry_mapped));
+	if (data->getBytes() == NULL) return shared_ptr<Data>();
+	
+	font_registry[abs_path] = data;
+	return data;
+}
+
+void FontRegistry::setMemoryMapped(bool mapped)
+{
+	lock_guard<mutex> lock(font_registry_mutex);
+	font_registry_mapped = mapped;
+}
+
+bool FontRegistry::isMemoryMapped()
+{
+	lock_guard<mutex> lock(font_registry_mutex);
+	return font_registry_mapped;
+}
+
+size_t FontRegistry::size()
+{
+	lock_guard<mutex> lock(font_registry_mutex);
+	
+	size_t n = 0;
+	map<string, weak_ptr<Data> >::iterator it = font_registry.begin();
+	while (it != font_registry.end())
+	{
+		if (it->second.expired()) font_registry.erase(it++);
+		else { n++; it++; }
+	}
+	return n;
+}
+
+#pragma mark - Context
+
+Context::Context(Backend::Type backend) : vg(NULL), backend(backend), frame(0)
+{
+	if (backend == Backend::SOFTWARE)
+		vg = nvgCreateSW(NVGSW_ANTIALIAS | NVGSW_STENCIL_STROKES);
+	else if (backend == Backend::NULL_RENDERER)
+		vg = nvgCreateNull(NVGNULL_ANTIALIAS | NVGNULL_RECORD);
+	else
+		vg = nvgCreateGL2(NVG_ANTIALIAS | NVG_STENCIL_STROKES);
+}
+
+Context::~Context()
+{
+	if (!vg) return;
+	
+	if (backend == Backend::SOFTWARE)
+		nvgDeleteSW(vg);
+	else if (backend == Backend::NULL_RENDERER)
+		nvgDeleteNull(vg);
+	else
+		nvgDeleteGL2(vg);
+}
+
+bool Context::loadFont(const string& path, const string& name)
+{
+	if (nvgFindFont(vg, name.c_str()) != -1) return true;
+	
+	shared_ptr<FontRegistry::Data> data = FontRegistry::load(path);
+	if (!data)
+	{
+		ofLogError("Context") << "font not found: " << path;
+		return false;
+	}
+	
+	// fontstash reads the shared bytes and must not free them
+	int n = nvgCreateFontMem(vg, name.c_str(), data->getBytes(), data->getSize(), 0);
+	if (n == -1)
+	{
+		ofLogError("Context") << "invalid font: " << path;
+		return false;
+	}
+	
+	fonts.push_back(data);
+	return true;
+}
+
+bool Context::saveGlyphCache(const string& path)
+{
+	int size = 0;
+	unsigned char* data = nvgSaveFontCache(vg, &size);
+	if (data == NULL) return false;
+	
+	ofstream file(ofToDataPath(path).c_str(), ios::binary);
+	file.write((const char*)data, size);
+	free(data);
+	
+	if (!file)
+	{
+		ofLogError("Context") << "can't write glyph cache: " << path;
+		return false;
+	}
+	return true;
+}
+
+bool Context::loadGlyphCache(const string& path)
+{
+	ifstream file(ofToDataPath(path).c_str(), ios::binary);
+	if (!file) return false;
+	
+	vector<unsigned char> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	if (data.empty()) return false;
+	
+	if (nvgLoadFontCache(vg, &data[0], data.size()) == 0)
+	{
+		ofLogWarning("Context") << "glyph cache is stale, discarded: " << path;
+		return false;
+	}
+	return true;
+}
+
+bool Context::setGlyphThreads(int num_threads)
+{
+	if (nvgGlyphThreads(vg, num_threads)) return true;
+	
+	ofLogWarning("Context") << "glyph threads are not available, glyphs are rasterized right away";
+	return false;
+}
+
+void Context::setFontSizeStep(float step)
+{
+	nvgFontSizeStep(vg, step);
+}
+
+void Context::setFontSDF(bool sdf)
+{
+	nvgFontSDF(vg, sdf);
+}
+
+void Context::setThreads(int num_threads)
+{
+	if (backend == Backend::SOFTWARE)
+		nvgswSetThreads(vg, num_threads);
+}
+
+int Context::getImage(const ofTexture& tex, int flags)
+{
+	const ofTextureData& data = tex.getTextureData();
+	ImageHandle& handle = image_handles[make_pair(data.textureID, flags)];
+	
+	// a reallocated texture can come back with the same id and a new size or target
+	if (handle.image && (handle.width != data.width || handle.height != data.height || handle.target != (int)data.textureTarget))
+	{
+		retired_images.push_back(handle.image);
+		handle.image = 0;
+	}
+	
+	if (handle.image == 0)
+	{
+		// the texture belongs to the ofTexture, nanovg must not delete it
+		int image_flags = flags | NVG_IMAGE_NODELETE;
+		
+		// ARB textures (the oF default) are sampled in place, in pixel coordinates
+		if (data.textureTarget == GL_TEXTURE_RECTANGLE)
+			image_flags |= NVG_IMAGE_RECTANGLE;
+		else if (data.textureTarget != GL_TEXTURE_2D)
+			ofLogError("ofxNanoVG::Image") << "texture target should be GL_TEXTURE_2D or GL_TEXTURE_RECTANGLE";
+		
+		handle.image = nvglCreateImageFromHandle(vg, data.textureID, data.width, data.height, image_flags);
+		handle.width = data.width;
+		handle.height = data.height;
+		handle.target = data.textureTarget;
+	}
+	
+	return handle.image;
+}
+
+int Context::getImage(const ofPixels& pixels, int flags)
+{
+	const unsigned char* data = pixels.getPixels();
+	int width = pixels.getWidth(), height = pixels.getHeight();
+	ImageHandle& handle = pixel_handles[make_pair(data, flags)];
+	
+	// reallocated pixels can come back at the same address with a new size
+	if (handle.image && (handle.width != width || handle.height != height))
+	{
+		retired_images.push_back(handle.image);
+		handle.image = 0;
+	}
+	
+	if (handle.image == 0)
+	{
+		handle.image = nvgCreateImageRGBA(vg, width, height, flags, data);
+		handle.width = width;
+		handle.height = height;
+	}
+	else if (handle.frame != frame)
+	{
+		nvgUpdateImage(vg, handle.image, data);
+	}
+	handle.frame = frame;
+	
+	return handle.image;
+}
+
+void Context::endFrame()
+{
+	for (size_t i = 0; i < retired_images.size(); i++)
+		nvgDeleteImage(vg, retired_images[i]);
+	retired_images.clear();
+	
+	// pixel buffers that were freed or reallocated at another address
+	map<pair<const unsigned char*, int>, ImageHandle>::iterator it = pixel_handles.begin();
+	while (it != pixel_handles.end())
+	{
+		if (it->second.frame < frame - 1)
+		{
+			if (it->second.image) nvgDeleteImage(vg, it->second.image);
+			pixel_handles.erase(it++);
+		}
+		else it++;
+	}
+	
+	frame++;
+}
+
 #pragma mark - Canvas
 
-void Canvas::allocate(int width, int height)
+void Canvas::allocate(int width, int height, Backend::Type backend)
+{
+	allocate(width, height, shared_ptr<Context>(new Context(backend)));
+}
+
+void Canvas::allocate(int width, int height, shared_ptr<Context> context)
 {
 	this->width = width;
 	this->height = height;
 
 	release();
 	
-	vg = nvgCreateGL2(NVG_ANTIALIAS | NVG_STENCIL_STROKES);
+	this->context = context;
+	this->vg = context->get();
+	this->backend = context->getBackend();
+	background_color.set(0, 0);
+	
+	if (backend == Backend::SOFTWARE)
+	{
+		context->setThreads(num_threads);
+		
+		pixels.allocate(width, height, OF_IMAGE_COLOR_ALPHA);
+		nvgswSetFramebuffer(vg, pixels.getPixels(), width, height, width * 4);
+		nvgswClear(vg, nvgRGBAf(background_color.r, background_color.g, background_color.b, background_color.a));
+		texture_dirty = true;
+		
+		return;
+	}
+	
+	if (backend == Backend::NULL_RENDERER) return;
 	
 	FrameBuffer *o = new FrameBuffer(width, height);
 	framebuffer = shared_ptr<FrameBuffer>(o);
 	
-	background_color.set(0, 0);
-	
 	framebuffer->bind();
 	framebuffer->clear(background_color.r, background_color.g, background_color.b, background_color.a);
 	framebuffer->unbind();
 }
 
+void Canvas::setThreads(int num_threads)
+{
+	this->num_threads = num_threads;
+	
+	if (context) context->setThreads(num_threads);
+}
+
 void Canvas::release()
 {
-	if (vg)
-	{
-		nvgDeleteGL2(vg);
-		vg = NULL;
-	}
+	context.reset();
+	vg = NULL;
 	
 	framebuffer.reset();
+	
+	pixels.clear();
+	texture.clear();
 }
 
 void Canvas::begin()
 {
-	glPushAttrib(GL_ALL_ATTRIB_BITS);
-	ofPushView();
-	ofViewport(0, ofGetViewportHeight() - height, width, height);
-
-	glDisable(GL_DEPTH_TEST);
-	glDisable(GL_LIGHTING);
+	begin_time = ofGetElapsedTimeMicros();
 	
-	framebuffer->bind();
-	framebuffer->clear(background_color.r, background_color.g, background_color.b, background_color.a);
+	if (backend == Backend::SOFTWARE)
+	{
+		// the context may be shared, point it at our pixels
+		nvgswSetFramebuffer(vg, pixels.getPixels(), width, height, width * 4);
+		nvgswClear(vg, nvgRGBAf(background_color.r, background_color.g, background_color.b, background_color.a));
+	}
+	else if (backend == Backend::OPENGL)
+	{
+		glPushAttrib(GL_ALL_ATTRIB_BITS);
+		ofPushView();
+		ofViewport(0, ofGetViewportHeight() - height, width, height);
+		
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_LIGHTING);
+		
+		framebuffer->bind();
+		framebuffer->clear(background_color.r, background_color.g, background_color.b, background_color.a);
+	}
 
 	nvgBeginFrame(vg, width, height, 1);
 	
@@ -288,6 +703,17 @@ void Canvas::begin()
 void Canvas::end()
 {
 	nvgEndFrame(vg);
+	context->endFrame();
+	
+	updateFrameStats();
+	
+	if (backend == Backend::SOFTWARE)
+	{
+		texture_dirty = true;
+		return;
+	}
+	
+	if (backend != Backend::OPENGL) return;
 	
 	// {{{ quick fix for nanovg vbo unbind bug
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -299,11 +725,102 @@ void Canvas::end()
 	glPopAttrib();
 }
 
+int Canvas::getImage(const ofTexture& tex, int flags)
+{
+	return context->getImage(tex, flags);
+}
+
+int Canvas::getImage(const ofPixels& pixels, int flags)
+{
+	return context->getImage(pixels, flags);
+}
+
+void Canvas::beginRecording(DisplayList& list)
+{
+	nvgBeginDisplayList(vg, list.get());
+}
+
+void Canvas::endRecording()
+{
+	nvgEndDisplayList(vg);
+}
+
+bool Canvas::replay(const DisplayList& list)
+{
+	return nvgDrawDisplayList(vg, list.get()) != 0;
+}
+
+void Canvas::updateFrameStats()
+{
+	NVGframeStats s;
+	nvgFrameStats(vg, &s);
+	
+	FrameStats& o = frame_stats;
+	o = FrameStats();
+	
+	o.draw_calls = s.drawCallCount;
+	o.fill_triangles = s.fillTriCount;
+	o.stroke_triangles = s.strokeTriCount;
+	o.text_triangles = s.textTriCount;
+	o.buffer_growths = s.allocCount;
+	o.glyph_misses = s.glyphMisses;
+	o.atlas_resets = s.atlasResets;
+	o.glyph_evictions = s.glyphEvictions;
+	o.kerning_lookups = s.kernLookups;
+	o.kerning_hits = s.kernHits;
+	
+	o.cpu_time = (ofGetElapsedTimeMicros() - begin_time) / 1000.0;
+	o.append_time = s.appendTime;
+	o.flatten_time = s.flattenTime;
+	o.expand_time = s.expandTime;
+	o.submit_time = s.submitTime;
+	o.glyph_time = s.glyphTime;
+	
+	if (backend == Backend::OPENGL)
+	{
+		NVGglStats gl;
+		nvglFrameStats(vg, &gl);
+		o.vertex_bytes = gl.vertexBytes;
+		o.uniform_bytes = gl.uniformBytes;
+	}
+	else if (backend == Backend::NULL_RENDERER)
+	{
+		NVGnullStats n;
+		nvgnullFrameStats(vg, &n);
+		o.vertex_bytes = (n.fillVerts + n.strokeVerts + n.triangleVerts) * sizeof(NVGvertex);
+	}
+	
+	frame_stats_history.push_back(o);
+	while ((int)frame_stats_history.size() > frame_stats_history_size)
+		frame_stats_history.pop_front();
+}
+
+void Canvas::setFrameStatsHistorySize(int size)
+{
+	frame_stats_history_size = max(size, 0);
+	while ((int)frame_stats_history.size() > frame_stats_history_size)
+		frame_stats_history.pop_front();
+}
+
 void Canvas::draw(float x, float y, float w, float h)
 {
 	if (w == 0) w = width;
 	if (h == 0) h = height;
 	
+	if (backend == Backend::SOFTWARE)
+	{
+		if (texture_dirty)
+		{
+			if (!texture.isAllocated()) texture.allocate(pixels);
+			texture.loadData(pixels);
+			texture_dirty = false;
+		}
+		texture.draw(x, y, w, h);
+		return;
+	}
+	
+	if (backend != Backend::OPENGL) return;
+	
 	framebuffer->draw(x, y, w, h);
 }
 
@@ -388,6 +905,38 @@ void Canvas::strokePath(const PaintStyle& paint)
 	nvgStroke(vg);
 }
 
+void Canvas::beginPath(Path& path)
+{
+	nvgBeginShape(vg, path.get());
+}
+
+void Canvas::endPath()
+{
+	nvgEndShape(vg);
+}
+
+void Canvas::fillPath(Path& path)
+{
+	nvgFillShape(vg, path.get());
+}
+
+void Canvas::fillPath(Path& path, const PaintStyle& paint)
+{
+	paint.fill(*this);
+	nvgFillShape(vg, path.get());
+}
+
+void Canvas::strokePath(Path& path)
+{
+	nvgStrokeShape(vg, path.get());
+}
+
+void Canvas::strokePath(Path& path, const PaintStyle& paint)
+{
+	paint.stroke(*this);
+	nvgStrokeShape(vg, path.get());
+}
+
 void Canvas::moveTo(float x, float y)
 {
 	nvgMoveTo(vg, x, y);
@@ -476,12 +1025,32 @@ void Canvas::scale(float x, float y)
 
 bool Canvas::loadFont(const string& path, const string& name)
 {
-	int n = nvgCreateFont(vg, name.c_str(), ofToDataPath(path).c_str());
-	if (n == -1)
-	{
-		ofLogError("Canvas") << "font not found: " << path;
-	}
-	return n != -1;
+	return context->loadFont(path, name);
+}
+
+bool Canvas::saveGlyphCache(const string& path)
+{
+	return context->saveGlyphCache(path);
+}
+
+bool Canvas::loadGlyphCache(const string& path)
+{
+	return context->loadGlyphCache(path);
+}
+
+bool Canvas::setGlyphThreads(int num_threads)
+{
+	return context->setGlyphThreads(num_threads);
+}
+
+void Canvas::setFontSizeStep(float step)
+{
+	context->setFontSizeStep(step);
+}
+
+void Canvas::setFontSDF(bool sdf)
+{
+	context->setFontSDF(sdf);
 }
 
 bool Canvas::fontStyle(const FontStyle& font_style)
@@ -506,6 +1075,72 @@ bool Canvas::textFont(const string& name)
 	return true;
 }
 
+int Canvas::prewarmGlyphs(const string& font_name, const vector<float>& sizes, const string& text)
+{
+	if (nvgFindFont(vg, font_name.c_str()) == -1)
+	{
+		ofLogError("Canvas") << "font not loaded: " << font_name;
+		return 0;
+	}
+	
+	int n = 0;
+	
+	// in a clean state, glyphs are rasterized at the font size of an untransformed text
+	nvgSave(vg);
+	nvgReset(vg);
+	nvgFontFace(vg, font_name.c_str());
+	
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		nvgFontSize(vg, sizes[i]);
+		n += nvgPrewarmText(vg, text.data(), text.data() + text.size());
+	}
+	
+	nvgRestore(vg);
+	
+	return n;
+}
+
+int Canvas::prewarmGlyphs(const string& font_name, const vector<float>& sizes, const vector<unsigned int>& codepoints)
+{
+	string text;
+	
+	for (size_t i = 0; i < codepoints.size(); i++)
+	{
+		unsigned int c = codepoints[i];
+		
+		if (c < 0x80)
+		{
+			text += (char)c;
+		}
+		else if (c < 0x800)
+		{
+			text += (char)(0xc0 | (c >> 6));
+			text += (char)(0x80 | (c & 0x3f));
+		}
+		else if (c < 0x10000)
+		{
+			text += (char)(0xe0 | (c >> 12));
+			text += (char)(0x80 | ((c >> 6) & 0x3f));
+			text += (char)(0x80 | (c & 0x3f));
+		}
+		else if (c < 0x110000)
+		{
+			text += (char)(0xf0 | (c >> 18));
+			text += (char)(0x80 | ((c >> 12) & 0x3f));
+			text += (char)(0x80 | ((c >> 6) & 0x3f));
+			text += (char)(0x80 | (c & 0x3f));
+		}
+	}
+	
+	return prewarmGlyphs(font_name, sizes, text);
+}
+
+int Canvas::getFontAtlasUsage(int* width, int* height) const
+{
+	return nvgFontAtlasUsage(vg, width, height);
+}
+
 void Canvas::text(const string& text, float x, float y, float line_break_width)
 {
 	if (line_break_width == 0)
@@ -557,6 +1192,97 @@ void Canvas::textAlign(int align)
 	nvgTextAlign(vg, align);
 }
 
+#pragma mark - TraceBuffer
+
+TraceBuffer::TraceBuffer(size_t capacity)
+: events(max(capacity, (size_t)1))
+, next(0)
+, count(0)
+, running(false)
+{}
+
+TraceBuffer::~TraceBuffer()
+{
+	stop();
+}
+
+void TraceBuffer::start()
+{
+	open.clear();
+	nvgSetTraceCallback(&TraceBuffer::callback, this);
+	running = true;
+}
+
+void TraceBuffer::stop()
+{
+	if (!running) return;
+	nvgSetTraceCallback(NULL, NULL);
+	running = false;
+}
+
+void TraceBuffer::clear()
+{
+	next = 0;
+	count = 0;
+	open.clear();
+}
+
+void TraceBuffer::callback(void* uptr, const char* name, int begin, double time)
+{
+	TraceBuffer* self = (TraceBuffer*)uptr;
+	
+	if (begin)
+	{
+		Event e = { name, time, time };
+		self->open.push_back(e);
+		return;
+	}
+	
+	if (self->open.empty()) return;
+	
+	Event e = self->open.back();
+	self->open.pop_back();
+	e.end = time;
+	
+	self->events[self->next] = e;
+	self->next = (self->next + 1) % self->events.size();
+	self->count = min(self->count + 1, self->events.size());
+}
+
+string TraceBuffer::toChromeTrace() const
+{
+	ostringstream out;
+	out.precision(3);
+	out << fixed;
+	
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+	
+	size_t first = (next + events.size() - count) % events.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		const Event& e = events[(first + i) % events.size()];
+		if (i > 0) out << ",";
+		out << "\n{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0"
+			<< ", \"ts\": " << e.begin * 1000.0
+			<< ", \"dur\": " << (e.end - e.begin) * 1000.0 << "}";
+	}
+	
+	out << "\n]}\n";
+	return out.str();
+}
+
+bool TraceBuffer::save(const string& path) const
+{
+	ofstream file(ofToDataPath(path).c_str());
+	if (!file)
+	{
+		ofLogError("TraceBuffer") << "can't write: " << path;
+		return false;
+	}
+	file << toChromeTrace();
+	return true;
+}
+
 
 
 
@@ -10,6 +10,7 @@
 OFX_NANOVG_BEGIN_NAMESPACE
 
 class FrameBuffer;
+class Context;
 class Canvas;
 
 struct TextAlign {
@@ -24,6 +25,15 @@ struct TextAlign {
 	};
 };
 
+struct Backend
+{
+	enum Type {
+		OPENGL,
+		SOFTWARE,
+		NULL_RENDERER // accepts and counts geometry, draws nothing (for profiling)
+	};
+};
+
 struct LineCap
 {
 	enum Type {
@@ -78,6 +88,30 @@ public:
 	int getAlign() const { return align; }
 };
 
+struct FrameStats
+{
+	int draw_calls;
+	int fill_triangles;
+	int stroke_triangles;
+	int text_triangles;
+	int buffer_growths; // command, path, point and vertex buffers grown by nanovg
+	
+	int vertex_bytes; // uploaded by the OpenGL backend, recorded by the null backend
+	int uniform_bytes; // OpenGL backend only
+	
+	int glyph_misses;
+	int atlas_resets;
+	int glyph_evictions;
+	int kerning_lookups;
+	int kerning_hits; // found in the kerning cache, kerning_hits / kerning_lookups is the hit rate
+	
+	// milliseconds
+	float cpu_time; // from begin() to end()
+	float append_time, flatten_time, expand_time, submit_time, glyph_time; // only with NVG_PROFILE defined
+	
+	FrameStats() { memset(this, 0, sizeof(*this)); }
+};
+
 struct PaintStyle {
 	virtual void fill(Canvas& canvas) const = 0;
 	virtual void stroke(Canvas& canvas) const = 0;
@@ -170,16 +204,27 @@ public:
 	float angle;
 	float alpha;
 	
-	Image() {}
+	Image() : angle(0), alpha(1), flags(0), tex(NULL), pixels(NULL) {}
 	~Image();
 	
 	Image(ofTexture* tex, const ofRectangle& rect, float angle = 0, float alpha = 1, int flags = 0)
-		: tex(tex)
-		, rect(rect)
+		: rect(rect)
+		, angle(angle)
+		, alpha(alpha)
+		, flags(flags)
+		, tex(tex)
+		, pixels(NULL)
+	{}
+	
+	// RGBA pixels, works with every backend. the image is kept by the context
+	// and updated from the pixels once per frame, see Context::getImage()
+	Image(ofPixels* pixels, const ofRectangle& rect, float angle = 0, float alpha = 1, int flags = 0)
+		: rect(rect)
 		, angle(angle)
 		, alpha(alpha)
-		, image(0)
 		, flags(flags)
+		, tex(NULL)
+		, pixels(pixels)
 	{}
 	
 	void fill(Canvas& canvas) const;
@@ -187,26 +232,205 @@ public:
 	
 protected:
 	
-	mutable int image;
 	int flags;
 	ofTexture* tex;
+	ofPixels* pixels;
+	
+	int upload(Canvas& canvas) const;
+};
+
+// Path commands kept for drawing many times, see Canvas::beginPath(Path&)
+class Path
+{
+public:
+	
+	Path();
+	~Path();
+	
+	NVGshape* get() const { return shape; }
+	
+private:
+	
+	NVGshape* shape;
+	
+	Path(const Path&);
+	Path& operator=(const Path&);
+};
+
+// Back-end calls recorded from a Canvas, see Canvas::beginRecording()
+class DisplayList
+{
+public:
+	
+	DisplayList();
+	~DisplayList();
+	
+	NVGdisplayList* get() const { return list; }
+	
+private:
+	
+	NVGdisplayList* list;
+	
+	DisplayList(const DisplayList&);
+	DisplayList& operator=(const DisplayList&);
+};
+
+// font files are read once per process. contexts loading the same file share
+// its bytes, which are freed when the last of them is deleted
+class FontRegistry
+{
+public:
+	
+	class Data
+	{
+	public:
+		
+		Data(const string& path, bool mapped);
+		~Data();
+		
+		const string& getPath() const { return path; }
+		unsigned char* getBytes() const { return bytes; }
+		size_t getSize() const { return size; }
+		bool isMapped() const { return mapping != NULL; }
+		
+	private:
+		
+		string path;
+		unsigned char* bytes; // NULL if the file can't be read
+		size_t size;
+		
+		vector<unsigned char> buffer;
+		void* mapping;
+		
+		Data(const Data&);
+		Data& operator=(const Data&);
+	};
+	
+	// NULL if the file can't be read
+	static shared_ptr<Data> load(const string& path);
+	
+	// number of font files in memory
+	static size_t size();
+	
+	// map font files read-only instead of reading them, so only the pages of
+	// the glyph tables in use get loaded. applies to files loaded afterwards,
+	// falls back to reading when the file can't be mapped
+	static void setMemoryMapped(bool mapped);
+	static bool isMemoryMapped();
+};
+
+// nanovg context with its shaders, font atlas and images. canvases allocated
+// with the same context draw through it one after another (begin() and end()
+// of two canvases must not overlap) and share fonts and glyph caches
+class Context
+{
+public:
+	
+	Context(Backend::Type backend = Backend::OPENGL);
+	~Context();
+	
+	NVGcontext* get() const { return vg; }
+	Backend::Type getBackend() const { return backend; }
+	
+	// loading a font name again is a no-op
+	bool loadFont(const string& path, const string& name);
+	
+	// glyph cache file: the font atlas and glyphs of the loaded fonts. loading
+	// it after the fonts skips rasterizing the cached glyphs, glyphs of fonts
+	// that changed or aren't loaded are discarded. load outside of begin()/end()
+	bool saveGlyphCache(const string& path);
+	bool loadGlyphCache(const string& path);
+	
+	// rasterize missing glyphs on worker threads instead of in text(). a glyph
+	// is left out until it's ready (the next frame at the earliest), 0 (the
+	// default) rasterizes right away
+	bool setGlyphThreads(int num_threads);
+	
+	// rasterize glyphs only at pixel sizes that are powers of step and scale
+	// them to the drawn size, so zooming text doesn't add glyphs every frame.
+	// e.g. 1.1 is close to exact, 1.5 keeps few sizes but looks softer. 0 (the
+	// default) rasterizes at the exact size
+	void setFontSizeStep(float step);
+	
+	// draw text from distance fields, one glyph per font for every size and
+	// blur, so the atlas no longer grows with the number of sizes. a little
+	// softer than glyphs rasterized at the size
+	void setFontSDF(bool sdf);
+	
+	// software backend
+	void setThreads(int num_threads);
+	
+	// nanovg image of a texture, created once for each texture and flags (OpenGL backend only)
+	int getImage(const ofTexture& tex, int flags);
+	
+	// nanovg image of RGBA pixels, created once for each pixel buffer and flags
+	// and updated from the pixels the first time it's used in a frame (all
+	// backends). pixels changed between two draws in one frame are all drawn
+	// with the contents of the first. images not used in the last two frames
+	// are deleted
+	int getImage(const ofPixels& pixels, int flags);
+	
+	// called by Canvas::end() after nvgEndFrame(), deletes the images replaced
+	// in the frame and the unused pixel images
+	void endFrame();
+	
+private:
+	
+	NVGcontext* vg;
+	Backend::Type backend;
+	
+	struct ImageHandle {
+		int image;
+		int width, height;
+		int target; // textures only
+		int frame; // last used
+	};
+	map<pair<GLuint, int>, ImageHandle> image_handles;
+	map<pair<const unsigned char*, int>, ImageHandle> pixel_handles;
+	
+	// the calls of the frame may still draw them, deleted in endFrame()
+	vector<int> retired_images;
+	int frame;
+	
+	// kept alive as long as the fonts are in vg
+	vector<shared_ptr<FontRegistry::Data> > fonts;
 	
-	void upload(NVGcontext* ctx) const;
+	Context(const Context&);
+	Context& operator=(const Context&);
 };
 
 class Canvas
 {
 public:
 	
-	Canvas() : vg(NULL) {}
+	Canvas() : vg(NULL), backend(Backend::OPENGL), num_threads(1), texture_dirty(false), frame_stats_history_size(300) {}
 	
-	void allocate(int width, int height);
+	void allocate(int width, int height, Backend::Type backend = Backend::OPENGL);
+	
+	// draw through a context shared with other canvases, only the
+	// framebuffer (or pixels) belongs to this canvas
+	void allocate(int width, int height, shared_ptr<Context> context);
+	
+	// software backend: rasterize with multiple threads (output stays the same).
+	// applies to every canvas of a shared context
+	void setThreads(int num_threads);
+	int getThreads() const { return num_threads; }
 	
 	void resetState();
 	
 	void begin();
 	void end();
 	
+	// display list: record the draw calls between begin() and end() once, then
+	// replay them without tessellation. the recorded geometry is in canvas
+	// coordinates, so the current transform doesn't apply. replay() returns
+	// false when the list has to be recorded again (empty, or the font atlas was reset
+	// or dropped glyphs the list draws)
+	
+	void beginRecording(DisplayList& list);
+	void endRecording();
+	bool replay(const DisplayList& list);
+	
 public:
 	
 	// draw commands
@@ -228,6 +452,17 @@ public:
 	void fillPath(const PaintStyle& paint);
 	void strokePath();
 	void strokePath(const PaintStyle& paint);
+	
+	// reusable path: the commands between beginPath(path) and endPath() are kept
+	// in path. the tessellation is cached, so drawing it again with only a
+	// different translation or rotation skips flattening and expansion
+	
+	void beginPath(Path& path);
+	void endPath();
+	void fillPath(Path& path);
+	void fillPath(Path& path, const PaintStyle& paint);
+	void strokePath(Path& path);
+	void strokePath(Path& path, const PaintStyle& paint);
 
 	void arc(float cx, float cy, float r, float a0, float a1, int dir);
 	
@@ -253,6 +488,19 @@ public:
 	bool loadFont(const string& path, const string& name);
 	bool textFont(const string& name);
 	
+	// see Context::saveGlyphCache()
+	bool saveGlyphCache(const string& path);
+	bool loadGlyphCache(const string& path);
+	
+	// see Context::setGlyphThreads()
+	bool setGlyphThreads(int num_threads);
+	
+	// see Context::setFontSizeStep()
+	void setFontSizeStep(float step);
+	
+	// see Context::setFontSDF()
+	void setFontSDF(bool sdf);
+	
 	void text(const string& text, float x, float y, float line_break_width = 0);
 	ofRectangle textBounds(const string& text, float x, float y, float line_break_width = 0);
 	
@@ -264,6 +512,16 @@ public:
 	
 	bool fontStyle(const FontStyle& font_style);
 	
+	// rasterize glyphs into the font atlas and upload it ahead of time (e.g. in
+	// setup), so they don't get rasterized mid animation. glyphs are cached per
+	// pixel size, prewarm the sizes the text is drawn at. returns the number of
+	// glyphs added
+	int prewarmGlyphs(const string& font_name, const vector<float>& sizes, const string& text);
+	int prewarmGlyphs(const string& font_name, const vector<float>& sizes, const vector<unsigned int>& codepoints);
+	
+	// pixels of all font atlas pages taken by glyphs, and the size of the current page
+	int getFontAtlasUsage(int* width = NULL, int* height = NULL) const;
+	
 	// transform
 	
 	void push();
@@ -282,20 +540,83 @@ public:
 	
 	void draw(float x, float y, float w = 0, float h = 0);
 	
+	// rendered image of the software backend (premultiplied alpha)
+	const ofPixels& getPixels() const { return pixels; }
+	
+	// stats of the last frame, and of the last frames with the oldest first
+	const FrameStats& getFrameStats() const { return frame_stats; }
+	const deque<FrameStats>& getFrameStatsHistory() const { return frame_stats_history; }
+	
+	void setFrameStatsHistorySize(int size);
+	int getFrameStatsHistorySize() const { return frame_stats_history_size; }
+	
 public:
 	
 	NVGcontext* getContext() const { return vg; }
+	const shared_ptr<Context>& getSharedContext() const { return context; }
+	Backend::Type getBackend() const { return backend; }
+	
+	// see Context::getImage()
+	int getImage(const ofTexture& tex, int flags);
+	int getImage(const ofPixels& pixels, int flags);
 	
 private:
 	
-	struct NVGcontext* vg;
+	shared_ptr<Context> context;
+	struct NVGcontext* vg; // context->get()
+	Backend::Type backend;
+	int num_threads;
 	
 	float width, height;
 	shared_ptr<FrameBuffer> framebuffer;
 	
+	ofPixels pixels;
+	ofTexture texture;
+	bool texture_dirty;
+	
 	ofFloatColor background_color;
 	
+	unsigned long long begin_time;
+	FrameStats frame_stats;
+	deque<FrameStats> frame_stats_history;
+	int frame_stats_history_size;
+	
 	void release();
+	void updateFrameStats();
+};
+
+// Keeps the last nanovg trace events (nanovg has to be built with NVG_TRACE)
+// and writes them as Chrome trace JSON, for chrome://tracing or Perfetto.
+class TraceBuffer
+{
+public:
+	
+	TraceBuffer(size_t capacity = 100000);
+	~TraceBuffer();
+	
+	void start();
+	void stop();
+	bool isRunning() const { return running; }
+	
+	void clear();
+	size_t size() const { return count; }
+	
+	string toChromeTrace() const;
+	bool save(const string& path) const;
+	
+protected:
+	
+	struct Event {
+		const char* name;
+		double begin, end;
+	};
+	
+	vector<Event> events; // ring buffer of finished events
+	size_t next, count;
+	vector<Event> open;
+	bool running;
+	
+	static void callback(void* uptr, const char* name, int begin, double time);
 };
 
 OFX_NANOVG_END_NAMESPACE